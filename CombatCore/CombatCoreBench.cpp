@@ -0,0 +1,139 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterCombatCore.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace ShooterCombatCore;
+
+//inputs are generated up front so the timed loops only run the combat math
+struct FBenchInput
+{
+	FVec3 Forward;
+	FVec3 Right;
+	FVec3 Velocity;
+	float AimYaw;
+	float DeltaTime;
+	bool bFalling;
+	bool bAiming;
+	bool bFiring;
+};
+
+template <typename FunctionType>
+static void Run(const char* Name, int Iterations, FunctionType Function)
+{
+
+	const auto Start = std::chrono::steady_clock::now();
+	const float Sink = Function();
+	const auto End = std::chrono::steady_clock::now();
+
+	const double Ns = std::chrono::duration<double, std::nano>(End - Start).count();
+	std::printf("%-18s %8.2f ns per call (%d calls, sink %g)\n", Name, Ns / Iterations, Iterations, Sink);
+
+}
+
+int main(int Argc, char** Argv)
+{
+
+	const int Iterations = Argc > 1 ? std::max(std::atoi(Argv[1]), 1) : 1000000;
+
+	std::vector<FBenchInput> Inputs(Iterations);
+	unsigned Seed = 4321;
+	auto Random = [&Seed](float Min, float Max) {
+		Seed = Seed * 1664525u + 1013904223u;
+		return Min + (Max - Min) * (static_cast<float>(Seed >> 8) / 16777216.f);
+	};
+	for (FBenchInput& Input : Inputs) {
+
+		const float Yaw = Random(-Pi, Pi);
+		Input.Forward = FVec3{ std::cos(Yaw), std::sin(Yaw), 0.f };
+		Input.Right = FVec3{ -std::sin(Yaw), std::cos(Yaw), 0.f };
+		Input.Velocity = FVec3{ Random(-600.f, 600.f), Random(-600.f, 600.f), Random(-100.f, 100.f) };
+		Input.AimYaw = Random(-180.f, 180.f);
+		Input.DeltaTime = Random(1.f / 144.f, 1.f / 20.f);
+		Input.bFalling = Random(0.f, 1.f) < 0.1f;
+		Input.bAiming = Random(0.f, 1.f) < 0.3f;
+		Input.bFiring = Random(0.f, 1.f) < 0.3f;
+
+	}
+
+	Run("StepSpread", Iterations, [&Inputs]() {
+
+		FSpreadState State;
+		float Sum = 0.f;
+		for (const FBenchInput& Input : Inputs) {
+
+			FSpreadInput SpreadInput;
+			SpreadInput.HorizontalSpeed = std::sqrt(Input.Velocity.X * Input.Velocity.X + Input.Velocity.Y * Input.Velocity.Y);
+			SpreadInput.bFalling = Input.bFalling;
+			SpreadInput.bAiming = Input.bAiming;
+			SpreadInput.bFiringBullet = Input.bFiring;
+			SpreadInput.ShootingSpread = 0.24f;
+			Sum += StepSpread(State, SpreadInput, Input.DeltaTime);
+
+		}
+		return Sum;
+
+	});
+
+	Run("ThrowImpulse", Iterations, [&Inputs]() {
+
+		float Sum = 0.f;
+		for (const FBenchInput& Input : Inputs) {
+			Sum += ThrowImpulse(Input.Forward, Input.Right).Z;
+		}
+		return Sum;
+
+	});
+
+	Run("MovementOffsetYaw", Iterations, [&Inputs]() {
+
+		float Sum = 0.f;
+		for (const FBenchInput& Input : Inputs) {
+			Sum += MovementOffsetYaw(Input.Velocity, Input.AimYaw);
+		}
+		return Sum;
+
+	});
+
+	Run("StepSpring", Iterations, [&Inputs]() {
+
+		FSpring Spring;
+		float Sum = 0.f;
+		for (const FBenchInput& Input : Inputs) {
+
+			if (Input.bFiring) {
+				Spring.Velocity += 80.f;
+			}
+			StepSpring(Spring, 400.f, 0.5f, Input.DeltaTime);
+			Sum += Spring.Value;
+
+		}
+		return Sum;
+
+	});
+
+	Run("StepFireCooldown", Iterations, [&Inputs]() {
+
+		float CooldownRemaining = 0.f;
+		float Shots = 0.f;
+		for (const FBenchInput& Input : Inputs) {
+
+			if (StepFireCooldown(CooldownRemaining, Input.bFiring, Input.DeltaTime) && Input.bFiring) {
+				CooldownRemaining += 0.1f;
+				Shots++;
+			}
+
+		}
+		return Shots;
+
+	});
+
+	return 0;
+
+}
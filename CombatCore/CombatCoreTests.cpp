@@ -0,0 +1,217 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterCombatCore.h"
+#include <cmath>
+#include <cstdio>
+#include <initializer_list>
+
+using namespace ShooterCombatCore;
+
+static int NumFailed = 0;
+
+static void CheckNear(const char* What, float Actual, float Expected, float Tolerance)
+{
+
+	if (std::fabs(Actual - Expected) > Tolerance) {
+		std::printf("FAIL %s: %g, expected %g\n", What, Actual, Expected);
+		NumFailed++;
+	}
+
+}
+
+static void Check(const char* What, bool bOk)
+{
+
+	if (!bOk) {
+		std::printf("FAIL %s\n", What);
+		NumFailed++;
+	}
+
+}
+
+static void TestInterpTo()
+{
+
+	CheckNear("InterpTo halfway", InterpTo(0.f, 10.f, 0.1f, 5.f), 5.f, 1.e-5f);
+	CheckNear("InterpTo no speed snaps", InterpTo(0.f, 10.f, 0.1f, 0.f), 10.f, 0.f);
+	CheckNear("InterpTo long frame clamps", InterpTo(0.f, 10.f, 1.f, 5.f), 10.f, 0.f);
+	CheckNear("InterpTo tiny distance snaps", InterpTo(1.f, 1.00001f, 0.01f, 1.f), 1.00001f, 0.f);
+	CheckNear("InterpTo backwards", InterpTo(2.f, -2.f, 0.05f, 10.f), 0.f, 1.e-5f);
+
+}
+
+static void TestMapRangeClamped()
+{
+
+	CheckNear("MapRangeClamped middle", MapRangeClamped(0.f, 600.f, 0.f, 1.f, 300.f), 0.5f, 1.e-6f);
+	CheckNear("MapRangeClamped above", MapRangeClamped(0.f, 600.f, 0.f, 1.f, 900.f), 1.f, 0.f);
+	CheckNear("MapRangeClamped below", MapRangeClamped(0.f, 600.f, 0.f, 1.f, -10.f), 0.f, 0.f);
+	CheckNear("MapRangeClamped reversed output", MapRangeClamped(0.f, 10.f, 4.f, 2.f, 5.f), 3.f, 1.e-6f);
+	CheckNear("MapRangeClamped empty range at max", MapRangeClamped(5.f, 5.f, 0.f, 1.f, 5.f), 1.f, 0.f);
+	CheckNear("MapRangeClamped empty range below", MapRangeClamped(5.f, 5.f, 0.f, 1.f, 4.f), 0.f, 0.f);
+
+}
+
+static void TestNormalizeAxis()
+{
+
+	CheckNear("NormalizeAxis 190", NormalizeAxis(190.f), -170.f, 1.e-4f);
+	CheckNear("NormalizeAxis -190", NormalizeAxis(-190.f), 170.f, 1.e-4f);
+	CheckNear("NormalizeAxis 180", NormalizeAxis(180.f), 180.f, 1.e-4f);
+	CheckNear("NormalizeAxis -180", NormalizeAxis(-180.f), 180.f, 1.e-4f);
+	CheckNear("NormalizeAxis 540", NormalizeAxis(540.f), 180.f, 1.e-4f);
+	CheckNear("NormalizeAxis 720", NormalizeAxis(720.f), 0.f, 1.e-4f);
+	CheckNear("NormalizeAxis -45", NormalizeAxis(-45.f), -45.f, 1.e-4f);
+
+}
+
+static void TestThrowImpulse()
+{
+
+	//right (0,1,0) rolled -20 deg about forward (1,0,0), then turned 30 deg about up
+	const float Sin20 = std::sin(20.f * Pi / 180.f);
+	const float Cos20 = std::cos(20.f * Pi / 180.f);
+	const float Sin30 = 0.5f;
+	const float Cos30 = std::sqrt(3.f) / 2.f;
+
+	const FVec3 Impulse = ThrowImpulse(FVec3{ 1.f, 0.f, 0.f }, FVec3{ 0.f, 1.f, 0.f });
+	CheckNear("ThrowImpulse X", Impulse.X, -Sin30 * Cos20 * 20'000.f, 0.5f);
+	CheckNear("ThrowImpulse Y", Impulse.Y, Cos30 * Cos20 * 20'000.f, 0.5f);
+	CheckNear("ThrowImpulse Z", Impulse.Z, -Sin20 * 20'000.f, 0.5f);
+
+	const float Strength = std::sqrt(Impulse.X * Impulse.X + Impulse.Y * Impulse.Y + Impulse.Z * Impulse.Z);
+	CheckNear("ThrowImpulse strength", Strength, 20'000.f, 1.f);
+
+	const FVec3 Unturned = ThrowImpulse(FVec3{ 1.f, 0.f, 0.f }, FVec3{ 0.f, 1.f, 0.f }, 0.f, 1.f);
+	CheckNear("ThrowImpulse unturned X", Unturned.X, 0.f, 1.e-5f);
+
+}
+
+static void TestMovementOffsetYaw()
+{
+
+	CheckNear("MovementOffsetYaw forward", MovementOffsetYaw(FVec3{ 1.f, 0.f, 0.f }, 0.f), 0.f, 1.e-4f);
+	CheckNear("MovementOffsetYaw strafe", MovementOffsetYaw(FVec3{ 1.f, 0.f, 0.f }, 90.f), -90.f, 1.e-4f);
+	CheckNear("MovementOffsetYaw backwards", MovementOffsetYaw(FVec3{ 0.f, 1.f, 0.f }, -90.f), 180.f, 1.e-4f);
+	CheckNear("MovementOffsetYaw wraps", MovementOffsetYaw(FVec3{ -1.f, -0.01f, 0.f }, 170.f), 10.57f, 0.01f);
+
+}
+
+static void TestStepFireCooldown()
+{
+
+	//ten seconds of held trigger at 0.1 s per shot is 100 shots at any step rate
+	for (const int TickRate : { 20, 30, 60, 144 }) {
+
+		float CooldownRemaining = 0.f;
+		bool bReady = true;
+		int Shots = 0;
+		for (int Step = 0; Step < 10 * TickRate; Step++) {
+
+			if (!bReady && StepFireCooldown(CooldownRemaining, true, 1.f / static_cast<float>(TickRate))) {
+				bReady = true;
+			}
+			if (bReady) {
+				Shots++;
+				bReady = false;
+				CooldownRemaining += 0.1f;
+			}
+
+		}
+
+		char What[64];
+		std::snprintf(What, sizeof(What), "StepFireCooldown cadence at %d Hz", TickRate);
+		CheckNear(What, (float)Shots, 100.f, 1.f);
+
+	}
+
+	float CooldownRemaining = 0.05f;
+	Check("StepFireCooldown not ready", !StepFireCooldown(CooldownRemaining, false, 0.02f));
+	Check("StepFireCooldown ready", StepFireCooldown(CooldownRemaining, false, 0.04f));
+	CheckNear("StepFireCooldown released trigger drops overshoot", CooldownRemaining, 0.f, 0.f);
+
+	CooldownRemaining = 0.05f;
+	StepFireCooldown(CooldownRemaining, true, 0.06f);
+	CheckNear("StepFireCooldown held trigger keeps overshoot", CooldownRemaining, -0.01f, 1.e-6f);
+
+}
+
+static void TestStepSpring()
+{
+
+	//under damped: overshoots past zero, then settles
+	FSpring Spring;
+	Spring.Velocity = 10.f;
+	bool bOvershot = false;
+	for (int Frame = 0; Frame < 300; Frame++) {
+
+		StepSpring(Spring, 400.f, 0.5f, 1.f / 60.f);
+		bOvershot |= Spring.Value < -1.e-3f;
+
+	}
+	Check("StepSpring under damped overshoots", bOvershot);
+	CheckNear("StepSpring under damped settles", Spring.Value, 0.f, 1.e-3f);
+
+	//critically damped: never crosses zero
+	Spring = FSpring();
+	Spring.Velocity = 10.f;
+	bool bCrossed = false;
+	for (int Frame = 0; Frame < 300; Frame++) {
+
+		StepSpring(Spring, 400.f, 1.f, 1.f / 60.f);
+		bCrossed |= Spring.Value < -1.e-4f;
+
+	}
+	Check("StepSpring critically damped stays on one side", !bCrossed);
+	CheckNear("StepSpring critically damped settles", Spring.Value, 0.f, 1.e-3f);
+
+	//a hitch of a whole second is substepped and stays bounded
+	Spring = FSpring();
+	Spring.Velocity = 10.f;
+	StepSpring(Spring, 400.f, 0.5f, 1.f);
+	Check("StepSpring long frame stays bounded", std::fabs(Spring.Value) < 1.f && std::isfinite(Spring.Velocity));
+
+}
+
+static void TestStepSpread()
+{
+
+	FSpreadState State;
+	FSpreadInput Input;
+	CheckNear("StepSpread at rest", StepSpread(State, Input, 1.f / 60.f), 0.5f, 1.e-6f);
+
+	Input.HorizontalSpeed = 600.f;
+	CheckNear("StepSpread full speed", StepSpread(State, Input, 1.f / 60.f), 1.5f, 1.e-6f);
+
+	//aiming closes the spread over a few frames
+	Input.HorizontalSpeed = 0.f;
+	Input.bAiming = true;
+	float Spread = 0.f;
+	for (int Frame = 0; Frame < 60; Frame++) {
+		Spread = StepSpread(State, Input, 1.f / 60.f);
+	}
+	CheckNear("StepSpread aimed", Spread, -0.1f, 1.e-4f);
+
+}
+
+int main()
+{
+
+	TestInterpTo();
+	TestMapRangeClamped();
+	TestNormalizeAxis();
+	TestThrowImpulse();
+	TestMovementOffsetYaw();
+	TestStepFireCooldown();
+	TestStepSpring();
+	TestStepSpread();
+
+	if (NumFailed > 0) {
+		std::printf("%d combat core checks failed\n", NumFailed);
+		return 1;
+	}
+	std::printf("All combat core checks passed\n");
+	return 0;
+
+}
@@ -7,13 +7,70 @@
 #include "Components/WidgetComponent.h"
 #include "Components/SphereComponent.h"
 #include "ShooterChar.h"
+#include "ShooterPerf.h"
+#include "ShooterTraceScheduler.h"
+#include "ShooterPickupInstancer.h"
+#include "EngineUtils.h"
+#include "Serialization/ArchiveCountMem.h"
+#include "HAL/IConsoleManager.h"
+#include "UObject/UObjectArray.h"
+#include "UObject/UObjectGlobals.h"
+#include "TheLastShooter.h"
+
+DECLARE_CYCLE_STAT(TEXT("SetItemProperties"), STAT_SetItemProperties, STATGROUP_TheLastShooter);
+
+static int32 GShooterItemClusters = 1;
+static FAutoConsoleVariableRef CVarShooterItemClusters(
+	TEXT("Shooter.GC.ItemClusters"),
+	GShooterItemClusters,
+	TEXT("Items lying on the ground become GC cluster roots with their components. Applies on the next item state change."));
+
+/** GC pause against the number of items in play, logged per collection */
+struct FItemGCTracker
+{
+	int32 NumItems = 0;
+	int32 NumClustered = 0;
+	double CollectStartSeconds = 0.0;
+
+	static FItemGCTracker& Get()
+	{
+		static FItemGCTracker Tracker;
+		return Tracker;
+	}
+
+	FItemGCTracker()
+	{
+
+		FCoreUObjectDelegates::GetPreGarbageCollectDelegate().AddRaw(this, &FItemGCTracker::OnPreGarbageCollect);
+		FCoreUObjectDelegates::GetPostGarbageCollect().AddRaw(this, &FItemGCTracker::OnPostGarbageCollect);
+
+	}
+
+	void OnPreGarbageCollect()
+	{
+		CollectStartSeconds = FPlatformTime::Seconds();
+	}
+
+	void OnPostGarbageCollect()
+	{
+
+		const float PauseMs = (float)((FPlatformTime::Seconds() - CollectStartSeconds) * 1000.0);
+		UE_LOG(LogShooter, Verbose, TEXT("GC took %.2f ms with %d items in play, %d of them clustered"), PauseMs, NumItems, NumClustered);
+		CSV_CUSTOM_STAT(TheLastShooter, GCPauseMs, PauseMs, ECsvCustomStatOp::Max);
+		CSV_CUSTOM_STAT(TheLastShooter, ItemsInPlay, NumItems, ECsvCustomStatOp::Set);
+		CSV_CUSTOM_STAT(TheLastShooter, ItemsClustered, NumClustered, ECsvCustomStatOp::Set);
+
+	}
+};
 
 // Sets default values
 AItem::AItem() :
 	ItemName(FString("Default")),
 	ItemCount(0),
 	ItemRarity(EItemRarity::EIR_Common),
-	ItemState(EItemState::EIS_PickUp)
+	ItemState(EItemState::EIS_PickUp),
+	GroundStaticMesh(nullptr),
+	GroundInstanceIndex(INDEX_NONE)
 {
 	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
@@ -23,11 +80,13 @@ AItem::AItem() :
 
 	CollisionBox = CreateDefaultSubobject<UBoxComponent>(TEXT("CollisionBox"));
 	CollisionBox->SetupAttachment(ItemMesh);
+	//only item focus sees the box, see the Interactable profile in TheLastShooter.h
 	CollisionBox->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Ignore);
 	CollisionBox->SetCollisionResponseToChannel(
-		ECollisionChannel::ECC_Visibility,
+		ECC_Interactable,
 		ECollisionResponse::ECR_Block);
 
+	//created in every build so Blueprint overrides of it load the same everywhere, BeginPlay drops it on the server
 	PickUpWidget = CreateDefaultSubobject<UWidgetComponent>(TEXT("PickUpWidget"));
 	PickUpWidget->SetupAttachment(GetRootComponent());
 
@@ -40,12 +99,16 @@ void AItem::BeginPlay()
 {
 	Super::BeginPlay();
 
-	//Hide pickupWidget
-	if (PickUpWidget) {
-		PickUpWidget->SetVisibility(false);
+	FItemGCTracker::Get().NumItems++;
+
+	//nobody looks at it on a server, don't tick or draw it
+	if ((!WITH_SHOOTER_COSMETICS || IsRunningDedicatedServer()) && PickUpWidget) {
+		PickUpWidget->DestroyComponent();
+		PickUpWidget = nullptr;
 	}
-	//set active stars array based on rarity
-	SetActiveStars();
+
+	//Hide pickupWidget
+	SetPickupWidgetVisibility(false);
 	if (this) {
 		//Setup overlap for AreaSphere
 		AreaSphere->OnComponentBeginOverlap.AddDynamic(this, &AItem::OnSphereOverlap);
@@ -54,6 +117,16 @@ void AItem::BeginPlay()
 	SetItemProperties(ItemState);
 }
 
+void AItem::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+
+	SetGroundInstanced(false);
+	SetGCClustered(false);
+	FItemGCTracker::Get().NumItems--;
+	Super::EndPlay(EndPlayReason);
+
+}
+
 void AItem::OnSphereOverlap(UPrimitiveComponent* OverlappedComponent,
 	AActor* OtherActor, UPrimitiveComponent* OtherComp,
 	int32 OtherBodyIndex, bool bFromSweep,
@@ -64,6 +137,7 @@ void AItem::OnSphereOverlap(UPrimitiveComponent* OverlappedComponent,
 		AShooterChar* ShooterCharacter = Cast<AShooterChar>(OtherActor);
 		if (ShooterCharacter) {
 			ShooterCharacter->IncrementOverlappedItemCount(1);
+			ShooterCharacter->AddFocusCandidate(this);
 		}
 	}
 
@@ -78,52 +152,42 @@ void AItem::OnSphereEndOverlap(UPrimitiveComponent* OverlappedComponent,
 		AShooterChar* ShooterCharacter = Cast<AShooterChar>(OtherActor);
 		if (ShooterCharacter) {
 			ShooterCharacter->IncrementOverlappedItemCount(-1);
+			ShooterCharacter->RemoveFocusCandidate(this);
 		}
 	}
 
 }
 
-void AItem::SetActiveStars()
+const FItemRarityData& AItem::GetRarityData(EItemRarity Rarity)
 {
-	// the 0 element isn't used
-	for (int32 i = 0; i <= 5; i++) {
 
-		ActiveStars.Add(false);
+	static const FItemRarityData RarityTable[] = {
+		//stars, glow, light, dark
+		FItemRarityData(1, FLinearColor(0.5f, 0.5f, 0.5f), FLinearColor(0.7f, 0.7f, 0.7f), FLinearColor(0.2f, 0.2f, 0.2f)), // Damaged
+		FItemRarityData(2, FLinearColor(0.2f, 0.9f, 0.2f), FLinearColor(0.5f, 1.f, 0.5f), FLinearColor(0.05f, 0.3f, 0.05f)), // Common
+		FItemRarityData(3, FLinearColor(0.2f, 0.5f, 1.f), FLinearColor(0.5f, 0.7f, 1.f), FLinearColor(0.05f, 0.15f, 0.4f)), // Uncommon
+		FItemRarityData(4, FLinearColor(0.6f, 0.2f, 1.f), FLinearColor(0.8f, 0.5f, 1.f), FLinearColor(0.2f, 0.05f, 0.4f)), // Rare
+		FItemRarityData(5, FLinearColor(1.f, 0.7f, 0.1f), FLinearColor(1.f, 0.85f, 0.4f), FLinearColor(0.4f, 0.25f, 0.02f)) // Legendary
+	};
+	static_assert(UE_ARRAY_COUNT(RarityTable) == (int32)EItemRarity::EIR_DefaultMax, "one entry per EItemRarity");
 
-	}
+	const int32 Index = (int32)Rarity;
+	return RarityTable[Index < (int32)UE_ARRAY_COUNT(RarityTable) ? Index : (int32)EItemRarity::EIR_Common];
 
-	switch (ItemRarity) {
-	case EItemRarity::EIR_Damaged:
-		ActiveStars[1] = true;
-		break;
-	case EItemRarity::EIR_Common:
-		ActiveStars[1] = true;
-		ActiveStars[2] = true;
-		break;
-	case EItemRarity::EIR_Uncommon:
-		ActiveStars[1] = true;
-		ActiveStars[2] = true;
-		ActiveStars[3] = true;
-		break;
-	case EItemRarity::EIR_Rare:
-		ActiveStars[1] = true;
-		ActiveStars[2] = true;
-		ActiveStars[3] = true;
-		ActiveStars[4] = true;
-		break;
-	case EItemRarity::EIR_Legendary:
-		ActiveStars[1] = true;
-		ActiveStars[2] = true;
-		ActiveStars[3] = true;
-		ActiveStars[4] = true;
-		ActiveStars[5] = true;
-		break;
-	}
+}
 
+bool AItem::IsStarActive(int32 Star) const
+{
+	return Star >= 0 && Star < 8 && (GetRarityData(ItemRarity).StarMask & (1 << Star)) != 0;
 }
 
 void AItem::SetItemProperties(EItemState State)
 {
+	SHOOTER_SCOPE_CYCLE_COUNTER(SetItemProperties);
+
+	if (State != EItemState::EIS_PickUp) {
+		SetGCClustered(false);
+	}
 
 	switch (State) {
 
@@ -138,13 +202,17 @@ void AItem::SetItemProperties(EItemState State)
 		AreaSphere->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
 
 		CollisionBox->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Ignore);
-		CollisionBox->SetCollisionResponseToChannel(ECollisionChannel::ECC_Visibility,
+		CollisionBox->SetCollisionResponseToChannel(ECC_Interactable,
 			ECollisionResponse::ECR_Block);
+		if (UShooterTraceScheduler::UseLegacyChannels()) {
+			CollisionBox->SetCollisionResponseToChannel(ECollisionChannel::ECC_Visibility,
+				ECollisionResponse::ECR_Block);
+		}
 		CollisionBox->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
 		break;
 
 	case EItemState::EIS_Equipped:
-		PickUpWidget->SetVisibility(false);
+		SetPickupWidgetVisibility(false);
 		ItemMesh->SetSimulatePhysics(false);
 		ItemMesh->SetEnableGravity(false);
 		ItemMesh->SetVisibility(true);
@@ -176,6 +244,78 @@ void AItem::SetItemProperties(EItemState State)
 		break;
 	}
 
+	//only idle pickups are instanced, anything moving or held draws its own mesh
+	SetGroundInstanced(State == EItemState::EIS_PickUp && UShooterPickupInstancer::IsEnabled());
+
+	//after BeginPlay, once the components have made everything they hold on to
+	if (State == EItemState::EIS_PickUp && (HasActorBegunPlay() || IsActorBeginningPlay())) {
+		SetGCClustered(IsGCClusteringEnabled());
+	}
+
+}
+
+bool AItem::CanBeClusterRoot() const
+{
+	return ItemState == EItemState::EIS_PickUp;
+}
+
+bool AItem::IsGCClustered() const
+{
+	return HasAnyInternalFlags(EInternalObjectFlags::ClusterRoot);
+}
+
+void AItem::SetGCClustered(bool bClustered)
+{
+
+	if (bClustered == IsGCClustered()) {
+		return;
+	}
+
+	if (bClustered) {
+		CreateCluster();
+		if (IsGCClustered()) {
+			FItemGCTracker::Get().NumClustered++;
+		}
+	}
+	else {
+		GUObjectClusters.DissolveCluster(this);
+		FItemGCTracker::Get().NumClustered--;
+	}
+
+}
+
+bool AItem::IsGCClusteringEnabled()
+{
+
+	static const IConsoleVariable* CVarCreateGCClusters = IConsoleManager::Get().FindConsoleVariable(TEXT("gc.CreateGCClusters"));
+	return GShooterItemClusters != 0 && (CVarCreateGCClusters == nullptr || CVarCreateGCClusters->GetInt() != 0);
+
+}
+
+void AItem::SetGroundInstanced(bool bInstanced)
+{
+
+	const bool bWasInstanced = GroundInstanceIndex != INDEX_NONE;
+	if (bInstanced == bWasInstanced && !bInstanced) {
+		return;
+	}
+
+	UShooterPickupInstancer* Instancer = UShooterPickupInstancer::Get(this);
+	if (Instancer) {
+
+		if (bInstanced && !bWasInstanced) {
+			Instancer->AddInstance(this);
+		}
+		else if (!bInstanced && bWasInstanced) {
+			Instancer->RemoveInstance(this);
+		}
+
+	}
+
+	const bool bDrawnByInstance = GroundInstanceIndex != INDEX_NONE;
+	ItemMesh->SetVisibility(!bDrawnByInstance);
+	ItemMesh->SetComponentTickEnabled(!bDrawnByInstance);
+
 }
 
 // Called every frame
@@ -185,11 +325,137 @@ void AItem::Tick(float DeltaTime)
 
 }
 
+void AItem::SetPickupWidgetVisibility(bool bVisible)
+{
+
+	if (PickUpWidget) {
+		PickUpWidget->SetVisibility(bVisible);
+	}
+
+}
+
 void AItem::SetItemState(EItemState State)
 {
 
 	ItemState = State;
+	FShooterFrameCounters::Get().AddItemStateTransition();
 	SetItemProperties(State);
 
 }
 
+static FAutoConsoleCommandWithWorldAndArgs CmdItemMemory(
+	TEXT("Shooter.ItemMemory"),
+	TEXT("Logs the average memory of an AItem in the current world, the actor and its components."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World) {
+
+		if (World == nullptr) {
+			return;
+		}
+
+		int32 NumItems = 0;
+		SIZE_T ActorBytes = 0;
+		SIZE_T ComponentBytes = 0;
+		for (TActorIterator<AItem> It(World); It; ++It) {
+
+			NumItems++;
+			ActorBytes += FArchiveCountMem(*It).GetMax();
+
+			TInlineComponentArray<UActorComponent*> Components(*It);
+			for (UActorComponent* Component : Components) {
+				ComponentBytes += FArchiveCountMem(Component).GetMax();
+			}
+
+		}
+
+		if (NumItems == 0) {
+			UE_LOG(LogShooter, Log, TEXT("No items in %s"), *World->GetName());
+			return;
+		}
+
+		UE_LOG(LogShooter, Log, TEXT("%d items: %llu bytes per actor (sizeof(AItem) %d), %llu bytes of components per item"),
+			NumItems,
+			(uint64)(ActorBytes / NumItems),
+			(int32)sizeof(AItem),
+			(uint64)(ComponentBytes / NumItems));
+
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs CmdGCBench(
+	TEXT("Shooter.GCBench"),
+	TEXT("Shooter.GCBench [Items] [Runs=5]: spawns the items under the map and times full garbage collections with and without item clusters. No Items = 1000, 10000 and 50000."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World) {
+
+		if (World == nullptr) {
+			return;
+		}
+
+		TArray<int32> ItemCounts;
+		if (Args.Num() > 0) {
+			ItemCounts.Add(FMath::Max(FCString::Atoi(*Args[0]), 1));
+		}
+		else {
+			ItemCounts = { 1000, 10000, 50000 };
+		}
+		const int32 NumRuns = FMath::Max(Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 5, 1);
+
+		auto TimeCollections = [NumRuns](float& OutAvgMs, float& OutMaxMs) {
+
+			OutAvgMs = 0.f;
+			OutMaxMs = 0.f;
+			for (int32 Run = 0; Run < NumRuns; Run++) {
+
+				const double StartSeconds = FPlatformTime::Seconds();
+				CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS, true);
+				const float Ms = (float)((FPlatformTime::Seconds() - StartSeconds) * 1000.0);
+				OutAvgMs += Ms / NumRuns;
+				OutMaxMs = FMath::Max(OutMaxMs, Ms);
+
+			}
+
+		};
+
+		for (const int32 NumItems : ItemCounts) {
+
+			//on a grid far below the map so their area spheres do not overlap each other
+			const int32 Side = FMath::CeilToInt(FMath::Sqrt((float)NumItems));
+			FActorSpawnParameters SpawnParams;
+			SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+			SpawnParams.ObjectFlags |= RF_Transient;
+
+			TArray<AItem*> Items;
+			Items.Reserve(NumItems);
+			for (int32 i = 0; i < NumItems; i++) {
+
+				const FVector Location((i % Side) * 200.f, (i / Side) * 200.f, -200'000.f);
+				Items.Add(World->SpawnActor<AItem>(AItem::StaticClass(), Location, FRotator::ZeroRotator, SpawnParams));
+
+			}
+
+			for (AItem* Item : Items) {
+				Item->SetGCClustered(true);
+			}
+			float ClusteredAvgMs, ClusteredMaxMs;
+			TimeCollections(ClusteredAvgMs, ClusteredMaxMs);
+
+			for (AItem* Item : Items) {
+				Item->SetGCClustered(false);
+			}
+			float UnclusteredAvgMs, UnclusteredMaxMs;
+			TimeCollections(UnclusteredAvgMs, UnclusteredMaxMs);
+
+			UE_LOG(LogShooter, Display, TEXT("GC bench, %d items: clustered avg %.2f ms max %.2f ms, unclustered avg %.2f ms max %.2f ms (%d runs)"),
+				NumItems,
+				ClusteredAvgMs,
+				ClusteredMaxMs,
+				UnclusteredAvgMs,
+				UnclusteredMaxMs,
+				NumRuns);
+
+			for (AItem* Item : Items) {
+				Item->Destroy();
+			}
+			CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS, true);
+
+		}
+
+	}));
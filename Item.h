@@ -28,10 +28,53 @@ enum class EItemState : uint8 {
 	EIS_Max UMETA(DisplayName = "Max")
 };
 
+/** Presentation of one rarity, shared by every item of that rarity */
+USTRUCT(BlueprintType)
+struct FItemRarityData
+{
+	GENERATED_BODY()
+
+	//bit N lights star N, bit 0 is unused like slot 0 of the widget's star row
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Rarity)
+	uint8 StarMask = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Rarity)
+	FLinearColor GlowColor = FLinearColor::White;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Rarity)
+	FLinearColor LightColor = FLinearColor::White;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Rarity)
+	FLinearColor DarkColor = FLinearColor::Black;
+
+	//StarMask as the six entry row the old star widgets read, built once per rarity
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Rarity)
+	TArray<bool> ActiveStars;
+
+	FItemRarityData() {}
+
+	FItemRarityData(int32 NumStars, const FLinearColor& InGlowColor, const FLinearColor& InLightColor, const FLinearColor& InDarkColor) :
+		StarMask((uint8)(((1 << (NumStars + 1)) - 1) & ~1)),
+		GlowColor(InGlowColor),
+		LightColor(InLightColor),
+		DarkColor(InDarkColor)
+	{
+
+		ActiveStars.SetNumUninitialized(6);
+		for (int32 Star = 0; Star < ActiveStars.Num(); Star++) {
+			ActiveStars[Star] = (StarMask & (1 << Star)) != 0;
+		}
+
+	}
+};
+
 UCLASS()
 class THELASTSHOOTER_API AItem : public AActor
 {
 	GENERATED_BODY()
+
+	//keeps GroundInstanceIndex
+	friend class UShooterPickupInstancer;
 	
 public:	
 	// Sets default values for this actor's properties
@@ -40,6 +83,8 @@ public:
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	
 	UFUNCTION()
 	void OnSphereOverlap(UPrimitiveComponent* OverlappedComponent,
@@ -55,12 +100,16 @@ protected:
 		UPrimitiveComponent* OtherComp,
 		int32 OtherBodyIndex);
 
-	//set the active stars of the item
-	void SetActiveStars();
-
 	// sets properties of the items components based on state 
 	void SetItemProperties(EItemState State);
 
+	//hands drawing over to the shared instanced mesh, or takes it back to ItemMesh
+	void SetGroundInstanced(bool bInstanced);
+
+	//idle pickups are GC cluster roots: the collector walks the cluster as one object instead of
+	//the actor and each of its components and references
+	virtual bool CanBeClusterRoot() const override;
+
 
 public:	
 	// Called every frame
@@ -96,10 +145,18 @@ private:
 	EItemRarity ItemRarity;
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Item Properties", meta = (AllowPrivateAccess = "true"))
+	EItemState ItemState; 
+
+	//old name kept for widget Blueprints, reads go to GetActiveStars. Always empty, no allocation per item
+	UPROPERTY(Transient, BlueprintGetter = GetActiveStars, Category = "Item Properties", meta = (AllowPrivateAccess = "true"))
 	TArray<bool> ActiveStars;
 
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Item Properties", meta = (AllowPrivateAccess = "true"))
-	EItemState ItemState; 
+	//static stand-in for ItemMesh while the item lies on the ground, drawn instanced with every other item using it
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Item Properties", meta = (AllowPrivateAccess = "true"))
+	class UStaticMesh* GroundStaticMesh;
+
+	//instance in the shared ground mesh, INDEX_NONE while ItemMesh draws the item
+	int32 GroundInstanceIndex;
 
 
 public:
@@ -109,7 +166,33 @@ public:
 	FORCEINLINE UBoxComponent* GetCollisionBox() const { return CollisionBox;}
 	FORCEINLINE EItemState GetItemState() const { return ItemState; }
 	FORCEINLINE USkeletalMeshComponent* GetItemMesh() const { return ItemMesh; }
+	FORCEINLINE EItemRarity GetItemRarity() const { return ItemRarity; }
+	FORCEINLINE UStaticMesh* GetGroundStaticMesh() const { return GroundStaticMesh; }
+
+	//one constant entry per rarity
+	static const FItemRarityData& GetRarityData(EItemRarity Rarity);
+
+	UFUNCTION(BlueprintPure, Category = "Item Properties")
+	const FItemRarityData& GetItemRarityData() const { return GetRarityData(ItemRarity); }
+
+	//shared row of the item's rarity, six entries, index 0 unused. A Blueprint read still copies it, widgets call IsStarActive
+	UFUNCTION(BlueprintGetter, meta = (DeprecatedFunction, DeprecationMessage = "Call IsStarActive(Star) for each star, reading the array copies it every frame."))
+	const TArray<bool>& GetActiveStars() const { return GetRarityData(ItemRarity).ActiveStars; }
+
+	UFUNCTION(BlueprintPure, Category = "Item Properties")
+	bool IsStarActive(int32 Star) const;
 	void SetItemState(EItemState State);
+
+	//no-op where the widget is compiled out (dedicated server)
+	void SetPickupWidgetVisibility(bool bVisible);
+
+	//makes the item the root of a GC cluster with its components, or dissolves the cluster
+	//before anything can point the item at objects the cluster does not know about
+	void SetGCClustered(bool bClustered);
+	bool IsGCClustered() const;
+
+	//Shooter.GC.ItemClusters, off whenever gc.CreateGCClusters is
+	static bool IsGCClusteringEnabled();
 	
 
 
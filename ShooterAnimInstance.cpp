@@ -5,9 +5,39 @@
 #include "ShooterChar.h"
 #include "GameFramework/CharacterMovementComponent.h"
 #include "Kismet/KismetMathLibrary.h"
+#include "TheLastShooter.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/ThreadSafeCounter64.h"
+
+DECLARE_CYCLE_STAT(TEXT("UpdateAnimationProperties"), STAT_UpdateAnimationProperties, STATGROUP_TheLastShooter);
+DECLARE_CYCLE_STAT(TEXT("RecoilSpringUpdate"), STAT_RecoilSpringUpdate, STATGROUP_TheLastShooter);
+
+static int32 GShooterProceduralRecoil = 1;
+static FAutoConsoleVariableRef CVarShooterProceduralRecoil(
+	TEXT("Shooter.Anim.ProceduralRecoil"),
+	GShooterProceduralRecoil,
+	TEXT("0 = every shot restarts HipFireMontage even where the anim blueprint has procedural recoil on, to compare the cost."));
+
+/** Totals behind Shooter.AnimCost, the proxies add to them from the worker threads */
+static FThreadSafeCounter64 GMontageShots;
+static FThreadSafeCounter64 GMontageShotCycles;
+static FThreadSafeCounter64 GRecoilImpulses;
+static FThreadSafeCounter64 GRecoilUpdateCycles;
+//summed over every anim instance, so the totals can be given per character per second
+static FThreadSafeCounter64 GAnimMicroseconds;
+
+UShooterAnimInstance::UShooterAnimInstance(const FObjectInitializer& ObjectInitializer) :
+	Super(ObjectInitializer),
+	bUseProceduralRecoil(false),
+	RecoilStiffness(400.f),
+	RecoilDampingRatio(0.5f),
+	PendingRecoilImpulse(FVector::ZeroVector)
+{
+}
 
 void UShooterAnimInstance::UpdateAnimationProperties(float DeltaTime)
 {
+	SHOOTER_SCOPE_CYCLE_COUNTER(UpdateAnimationProperties);
 
 	if (ShooterChar == nullptr) {
 
@@ -33,9 +63,9 @@ void UShooterAnimInstance::UpdateAnimationProperties(float DeltaTime)
 			bIsAccelerating = false; 
 		}
 
-		FRotator AimRotation = ShooterChar->GetBaseAimRotation();
-		FRotator MovementRotation = UKismetMathLibrary::MakeRotFromX(ShooterChar->GetVelocity());
-		MovementOffsetYaw = UKismetMathLibrary::NormalizedDeltaRotator(MovementRotation, AimRotation).Yaw;
+		const FVector CharVelocity = ShooterChar->GetVelocity();
+		MovementOffsetYaw = ShooterCombatCore::MovementOffsetYaw(ShooterCombatCore::FVec3{ CharVelocity.X, CharVelocity.Y, CharVelocity.Z },
+			ShooterChar->GetBaseAimRotation().Yaw);
 
 
 		if (ShooterChar->GetVelocity().Size() > 0.f) {
@@ -54,3 +84,102 @@ void UShooterAnimInstance::NativeInitializeAnimation()
 	ShooterChar = Cast<AShooterChar>(TryGetPawnOwner());
 
 }
+
+bool UShooterAnimInstance::UsesProceduralRecoil() const
+{
+	return bUseProceduralRecoil && GShooterProceduralRecoil != 0;
+}
+
+void UShooterAnimInstance::AddRecoilImpulse(float Pitch, float Yaw, float Kickback)
+{
+
+	PendingRecoilImpulse += FVector(Pitch, Yaw, Kickback);
+	GRecoilImpulses.Increment();
+
+}
+
+void UShooterAnimInstance::AddMontageShotCycles(uint32 Cycles)
+{
+
+	GMontageShots.Increment();
+	GMontageShotCycles.Add(Cycles);
+
+}
+
+FAnimInstanceProxy* UShooterAnimInstance::CreateAnimInstanceProxy()
+{
+	return &Proxy;
+}
+
+void UShooterAnimInstance::DestroyAnimInstanceProxy(FAnimInstanceProxy* InProxy)
+{
+}
+
+void FShooterAnimInstanceProxy::PreUpdate(UAnimInstance* InAnimInstance, float DeltaSeconds)
+{
+
+	FAnimInstanceProxy::PreUpdate(InAnimInstance, DeltaSeconds);
+
+	UShooterAnimInstance* ShooterAnim = CastChecked<UShooterAnimInstance>(InAnimInstance);
+	bUseProceduralRecoil = ShooterAnim->UsesProceduralRecoil();
+	RecoilStiffness = ShooterAnim->RecoilStiffness;
+	RecoilDampingRatio = ShooterAnim->RecoilDampingRatio;
+
+	RecoilPitch.Velocity += ShooterAnim->PendingRecoilImpulse.X;
+	RecoilYaw.Velocity += ShooterAnim->PendingRecoilImpulse.Y;
+	RecoilKickback.Velocity += ShooterAnim->PendingRecoilImpulse.Z;
+	ShooterAnim->PendingRecoilImpulse = FVector::ZeroVector;
+
+}
+
+void FShooterAnimInstanceProxy::Update(float DeltaSeconds)
+{
+
+	FAnimInstanceProxy::Update(DeltaSeconds);
+
+	GAnimMicroseconds.Add((int64)(DeltaSeconds * 1000000.f));
+	if (!bUseProceduralRecoil) {
+		return;
+	}
+
+	SHOOTER_SCOPE_CYCLE_COUNTER(RecoilSpringUpdate);
+	const uint32 StartCycles = FPlatformTime::Cycles();
+
+	ShooterCombatCore::StepSpring(RecoilPitch, RecoilStiffness, RecoilDampingRatio, DeltaSeconds);
+	ShooterCombatCore::StepSpring(RecoilYaw, RecoilStiffness, RecoilDampingRatio, DeltaSeconds);
+	ShooterCombatCore::StepSpring(RecoilKickback, RecoilStiffness, RecoilDampingRatio, DeltaSeconds);
+
+	//the graph reads these right after this update, on this same thread
+	RecoilRotation = FRotator(RecoilPitch.Value, RecoilYaw.Value, 0.f);
+	RecoilOffset = FVector(-RecoilKickback.Value, 0.f, 0.f);
+
+	GRecoilUpdateCycles.Add(FPlatformTime::Cycles() - StartCycles);
+
+}
+
+static FAutoConsoleCommand CmdAnimCost(
+	TEXT("Shooter.AnimCost"),
+	TEXT("Logs the per shot animation cost of montage restarts and procedural recoil, per character per second of animation. 'Shooter.AnimCost reset' clears it."),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args) {
+
+		if (Args.Num() > 0 && Args[0] == TEXT("reset")) {
+			GMontageShots.Reset();
+			GMontageShotCycles.Reset();
+			GRecoilImpulses.Reset();
+			GRecoilUpdateCycles.Reset();
+			GAnimMicroseconds.Reset();
+			return;
+		}
+
+		const double CharacterSeconds = GAnimMicroseconds.GetValue() / 1000000.0;
+		const double MontageUs = FPlatformTime::ToMilliseconds64(GMontageShotCycles.GetValue()) * 1000.0;
+		const double RecoilUs = FPlatformTime::ToMilliseconds64(GRecoilUpdateCycles.GetValue()) * 1000.0;
+		UE_LOG(LogShooter, Display, TEXT("Anim cost over %.1f character seconds: %lld montage shots, %.2f us each, %.1f us per character second on the game thread; %lld recoil impulses, springs %.1f us per character second on the workers. Montage blending and notifies come on top, see stat anim."),
+			CharacterSeconds,
+			GMontageShots.GetValue(),
+			GMontageShots.GetValue() > 0 ? MontageUs / GMontageShots.GetValue() : 0.0,
+			CharacterSeconds > 0.0 ? MontageUs / CharacterSeconds : 0.0,
+			GRecoilImpulses.GetValue(),
+			CharacterSeconds > 0.0 ? RecoilUs / CharacterSeconds : 0.0);
+
+	}));
@@ -4,8 +4,44 @@
 
 #include "CoreMinimal.h"
 #include "Animation/AnimInstance.h"
+#include "Animation/AnimInstanceProxy.h"
+#include "ShooterCombatCore.h"
 #include "ShooterAnimInstance.generated.h"
 
+/**
+ * Steps the recoil springs on the animation worker thread. The instance owns it as its Proxy
+ * property, so the anim graph reads the outputs from here on the same thread that writes them.
+ */
+USTRUCT(BlueprintType)
+struct FShooterAnimInstanceProxy : public FAnimInstanceProxy
+{
+	GENERATED_BODY()
+
+	FShooterAnimInstanceProxy() {}
+	FShooterAnimInstanceProxy(UAnimInstance* InAnimInstance) : FAnimInstanceProxy(InAnimInstance) {}
+
+	//game thread, takes the impulses added since the last update
+	virtual void PreUpdate(UAnimInstance* InAnimInstance, float DeltaSeconds) override;
+	//worker thread
+	virtual void Update(float DeltaSeconds) override;
+
+	//spring outputs, the anim graph adds them to the weapon hand with a Transform (Modify) Bone node
+	UPROPERTY(Transient, BlueprintReadOnly, Category = Recoil)
+	FRotator RecoilRotation = FRotator::ZeroRotator;
+
+	UPROPERTY(Transient, BlueprintReadOnly, Category = Recoil)
+	FVector RecoilOffset = FVector::ZeroVector;
+
+private:
+	ShooterCombatCore::FSpring RecoilPitch;
+	ShooterCombatCore::FSpring RecoilYaw;
+	ShooterCombatCore::FSpring RecoilKickback;
+
+	float RecoilStiffness = 0.f;
+	float RecoilDampingRatio = 0.f;
+	bool bUseProceduralRecoil = false;
+};
+
 /**
  * 
  */
@@ -13,13 +49,31 @@ UCLASS()
 class THELASTSHOOTER_API UShooterAnimInstance : public UAnimInstance
 {
 	GENERATED_BODY()
+
+	friend struct FShooterAnimInstanceProxy;
 	
 public:
+	UShooterAnimInstance(const FObjectInitializer& ObjectInitializer);
+
 	UFUNCTION(BlueprintCallable)
 	void UpdateAnimationProperties(float DeltaTime);	
 
 	virtual void NativeInitializeAnimation() override;
 
+	//per shot instead of restarting the hip fire montage, see FShooterAnimInstanceProxy::RecoilRotation
+	bool UsesProceduralRecoil() const;
+
+	//velocity kick to the recoil springs: degrees per second of pitch and yaw, cm per second of kickback
+	void AddRecoilImpulse(float Pitch, float Yaw, float Kickback);
+
+	//game thread cost of a hip fire montage restart, for Shooter.AnimCost
+	static void AddMontageShotCycles(uint32 Cycles);
+
+protected:
+	virtual FAnimInstanceProxy* CreateAnimInstanceProxy() override;
+	//Proxy is a member, nothing to delete
+	virtual void DestroyAnimInstanceProxy(FAnimInstanceProxy* InProxy) override;
+
 private:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Movement, meta = (AllowPrivateAccess = "true"))
 	class AShooterChar* ShooterChar;
@@ -43,4 +97,23 @@ private:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Movement, meta = (AllowPrivateAccess = "true"))
 	bool bAiming; 
 
+	//shots kick springs stepped in the worker thread update instead of playing HipFireMontage.
+	//The anim graph reads Proxy.RecoilRotation and Proxy.RecoilOffset
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Recoil, meta = (AllowPrivateAccess = "true"))
+	bool bUseProceduralRecoil;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Recoil, meta = (AllowPrivateAccess = "true"))
+	float RecoilStiffness;
+
+	//1 = settles without overshoot
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Recoil, meta = (AllowPrivateAccess = "true"))
+	float RecoilDampingRatio;
+
+	//only read from the anim graph, the event graph would race the worker thread
+	UPROPERTY(Transient, BlueprintReadOnly, Category = Recoil, meta = (AllowPrivateAccess = "true"))
+	FShooterAnimInstanceProxy Proxy;
+
+	//pitch, yaw, kickback impulses not handed to the proxy yet
+	FVector PendingRecoilImpulse;
+
 };
@@ -0,0 +1,145 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterBotController.h"
+#include "ShooterChar.h"
+#include "NavigationSystem.h"
+
+AShooterBotController::AShooterBotController() :
+	WanderRadius(3000.f),
+	MinThinkInterval(1.f),
+	MaxThinkInterval(4.f),
+	MaxBurstTime(1.5f),
+	ThinkTimer(0.f),
+	BurstTimer(0.f),
+	bTriggerHeld(false)
+{
+
+	PrimaryActorTick.bCanEverTick = true;
+
+}
+
+void AShooterBotController::SetRandomSeed(int32 Seed)
+{
+
+	Stream.Initialize(Seed);
+	//spread the first decisions so bots don't all think on the same frame
+	ThinkTimer = Stream.FRandRange(0.f, MaxThinkInterval);
+
+}
+
+void AShooterBotController::Tick(float DeltaSeconds)
+{
+
+	Super::Tick(DeltaSeconds);
+
+	AShooterChar* Bot = Cast<AShooterChar>(GetPawn());
+	if (Bot == nullptr) {
+		return;
+	}
+
+	//nobody is close enough to see it: no new paths, no shots, the crowd subsystem carries it
+	if (Bot->IsCrowdDemoted()) {
+
+		if (bTriggerHeld) {
+			Bot->FireButtonReleased();
+			bTriggerHeld = false;
+		}
+		return;
+
+	}
+
+	ThinkTimer -= DeltaSeconds;
+	if (ThinkTimer <= 0.f) {
+
+		Think(Bot);
+		ThinkTimer = Stream.FRandRange(MinThinkInterval, MaxThinkInterval);
+
+	}
+
+	UpdateTrigger(Bot, DeltaSeconds);
+
+}
+
+void AShooterBotController::OnUnPossess()
+{
+
+	AShooterChar* Bot = Cast<AShooterChar>(GetPawn());
+	if (Bot && bTriggerHeld) {
+		Bot->FireButtonReleased();
+	}
+	bTriggerHeld = false;
+
+	Super::OnUnPossess();
+
+}
+
+void AShooterBotController::Think(AShooterChar* Bot)
+{
+
+	const FVector BotLocation{ Bot->GetActorLocation() };
+
+	if (GetMoveStatus() == EPathFollowingStatus::Idle) {
+
+		UNavigationSystemV1* NavSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+		FNavLocation Destination;
+		if (NavSystem && NavSystem->GetRandomReachablePointInRadius(BotLocation, WanderRadius, Destination)) {
+			MoveToLocation(Destination.Location);
+		}
+
+	}
+
+	//look somewhere around eye height
+	const FVector LookDirection{ FRotator(Stream.FRandRange(-10.f, 10.f), Stream.FRandRange(-180.f, 180.f), 0.f).Vector() };
+	SetFocalPoint(Bot->GetPawnViewLocation() + LookDirection * 2000.f);
+
+	if (Stream.FRand() < 0.3f) {
+		Bot->AimingButtonPressed();
+	}
+	else {
+		Bot->AimingButtonReleased();
+	}
+
+	TrySwapWeapon(Bot);
+
+}
+
+void AShooterBotController::UpdateTrigger(AShooterChar* Bot, float DeltaSeconds)
+{
+
+	BurstTimer -= DeltaSeconds;
+	if (BurstTimer > 0.f) {
+		return;
+	}
+
+	bTriggerHeld = !bTriggerHeld;
+	if (bTriggerHeld) {
+		Bot->FireButtonPressed();
+	}
+	else {
+		Bot->FireButtonReleased();
+	}
+	BurstTimer = Stream.FRandRange(0.1f, MaxBurstTime);
+
+}
+
+void AShooterBotController::TrySwapWeapon(AShooterChar* Bot)
+{
+
+	if (Bot->GetOverlappedItemCount() <= 0) {
+		return;
+	}
+
+	TArray<AActor*> OverlappingWeapons;
+	Bot->GetOverlappingActors(OverlappingWeapons, AWeapon::StaticClass());
+	for (AActor* Actor : OverlappingWeapons) {
+
+		AWeapon* Weapon = Cast<AWeapon>(Actor);
+		if (Weapon && Weapon->GetItemState() == EItemState::EIS_PickUp) {
+			Bot->SwapWeapon(Weapon);
+			return;
+		}
+
+	}
+
+}
@@ -0,0 +1,53 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AIController.h"
+#include "ShooterBotController.generated.h"
+
+/**
+ * Load-test bot: wanders the navmesh, looks around, fires in bursts and swaps to
+ * any weapon it walks over. Drives AShooterChar through its regular input handlers.
+ */
+UCLASS()
+class THELASTSHOOTER_API AShooterBotController : public AAIController
+{
+	GENERATED_BODY()
+
+public:
+	AShooterBotController();
+
+	virtual void Tick(float DeltaSeconds) override;
+
+	void SetRandomSeed(int32 Seed);
+
+protected:
+	virtual void OnUnPossess() override;
+
+	//pick a new destination, focal point and maybe a new weapon
+	void Think(class AShooterChar* Bot);
+
+	void UpdateTrigger(AShooterChar* Bot, float DeltaSeconds);
+
+	void TrySwapWeapon(AShooterChar* Bot);
+
+private:
+	UPROPERTY(EditAnywhere, Category = Bot, meta = (AllowPrivateAccess = "true"))
+	float WanderRadius;
+
+	UPROPERTY(EditAnywhere, Category = Bot, meta = (AllowPrivateAccess = "true"))
+	float MinThinkInterval;
+
+	UPROPERTY(EditAnywhere, Category = Bot, meta = (AllowPrivateAccess = "true"))
+	float MaxThinkInterval;
+
+	//how long the trigger is held / released, picked between 0 and this
+	UPROPERTY(EditAnywhere, Category = Bot, meta = (AllowPrivateAccess = "true"))
+	float MaxBurstTime;
+
+	FRandomStream Stream;
+	float ThinkTimer;
+	float BurstTimer;
+	bool bTriggerHeld;
+};
@@ -16,6 +16,52 @@
 #include "Weapon.h"
 #include "Components/SphereComponent.h"
 #include "Components/BoxComponent.h"
+#include "TheLastShooter.h"
+#include "Engine/AssetManager.h"
+#include "ShooterDamageQueue.h"
+#include "WeaponData.h"
+#include "Animation/AnimMontage.h"
+#include "Components/CapsuleComponent.h"
+#include "HAL/IConsoleManager.h"
+#include "ShooterTelemetry.h"
+#include "ShooterKillCamComponent.h"
+#include "ShooterCombatCore.h"
+#include "ShooterAnimInstance.h"
+#include "ShooterCrowdSubsystem.h"
+#include "ShooterWarmUpSubsystem.h"
+
+DECLARE_CYCLE_STAT(TEXT("FireWeapon"), STAT_FireWeapon, STATGROUP_TheLastShooter);
+DECLARE_CYCLE_STAT(TEXT("GetBeamEndLocation"), STAT_GetBeamEndLocation, STATGROUP_TheLastShooter);
+DECLARE_CYCLE_STAT(TEXT("TraceUndercrosshairs"), STAT_TraceUndercrosshairs, STATGROUP_TheLastShooter);
+DECLARE_CYCLE_STAT(TEXT("TraceForItems"), STAT_TraceForItems, STATGROUP_TheLastShooter);
+DECLARE_CYCLE_STAT(TEXT("CalculateCrosshairSpread"), STAT_CalculateCrosshairSpread, STATGROUP_TheLastShooter);
+
+static float GShooterItemFocusRange = 1500.f;
+static FAutoConsoleVariableRef CVarShooterItemFocusRange(
+	TEXT("Shooter.ItemFocus.Range"),
+	GShooterItemFocusRange,
+	TEXT("Length of the item focus trace from the camera, on the Interactable channel."));
+
+static int32 GShooterItemFocusCone = 1;
+static FAutoConsoleVariableRef CVarShooterItemFocusCone(
+	TEXT("Shooter.ItemFocus.Cone"),
+	GShooterItemFocusCone,
+	TEXT("1 = focus the overlapped item best scored by view angle and distance, checked with one Interactable trace, 0 = crosshair trace against the item boxes every frame."));
+
+static float GShooterItemFocusConeDegrees = 15.f;
+static FAutoConsoleVariableRef CVarShooterItemFocusConeDegrees(
+	TEXT("Shooter.ItemFocus.ConeDegrees"),
+	GShooterItemFocusConeDegrees,
+	TEXT("Half angle around the view direction an item must be in to get focus."));
+
+static int32 GShooterCombatTickRate = 60;
+static FAutoConsoleVariableRef CVarShooterCombatTickRate(
+	TEXT("Shooter.Combat.TickRate"),
+	GShooterCombatTickRate,
+	TEXT("Hz of the fixed step combat simulation (crosshair spread, fire cadence, firing state), independent of the frame rate. 0 = legacy, advanced by the frame DeltaTime and timers."));
+
+//frames longer than this many combat steps drop the rest instead of spiralling
+static const int32 MaxCombatSubsteps = 8;
 
 // Sets default values
 AShooterChar::AShooterChar() :
@@ -41,12 +87,25 @@ AShooterChar::AShooterChar() :
 	CrosshairInAirFactor(0.f),
 	CrosshairAimFactor(0.f),
 	CrosshairShootingFactor(0.f),
+	EquipedWeaponData(nullptr),
+	BarrelSocket(nullptr),
+	DefaultWeaponRequestSeconds(0.0),
+	WeaponDataRequestSeconds(0.0),
 	ShootTimeDuration(0.05f),
+	ShootingSpread(0.3f),
 	bFiringBullet(false),
 	AutomaticFireRate(0.1f),
 	bShouldFire(true),
 	bFireButtonPressed(false),
-	bShouldTraceForItems(false)
+	CombatStepAccumulator(0.f),
+	FireCooldownRemaining(0.f),
+	FiringBulletRemaining(0.f),
+	PreviousStepSpreadMultiplier(0.f),
+	LatestStepSpreadMultiplier(0.f),
+	bShouldTraceForItems(false),
+	ReplayHeldActions(0),
+	CrowdIndex(INDEX_NONE),
+	bCrowdDemoted(false)
 {
 	// Set this character to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
@@ -63,6 +122,7 @@ AShooterChar::AShooterChar() :
 	FollowCamera->SetupAttachment(CameraSpringArm, USpringArmComponent::SocketName);
 	FollowCamera->bUsePawnControlRotation = false;
 
+	KillCam = CreateDefaultSubobject<UShooterKillCamComponent>(TEXT("KillCam"));
 
 	//DON"T ROTATE WHEN THE CONTROLLER ROTATE
 	bUseControllerRotationPitch = false;
@@ -75,6 +135,20 @@ AShooterChar::AShooterChar() :
 	GetCharacterMovement()->JumpZVelocity = 600.f;
 	GetCharacterMovement()->AirControl = 0.2f;
 
+	//shots stop at characters through the hitbox subsystem, not their collision
+	GetCapsuleComponent()->SetCollisionResponseToChannel(ECC_WeaponFire, ECollisionResponse::ECR_Ignore);
+	GetMesh()->SetCollisionResponseToChannel(ECC_WeaponFire, ECollisionResponse::ECR_Ignore);
+
+	//hitboxes for the default mannequin skeleton
+	Hitboxes = {
+		{ EShooterBodyPart::ESBP_Head, FName("head"), FName("head"), 15.f },
+		{ EShooterBodyPart::ESBP_Torso, FName("pelvis"), FName("spine_03"), 22.f },
+		{ EShooterBodyPart::ESBP_LeftArm, FName("upperarm_l"), FName("hand_l"), 8.f },
+		{ EShooterBodyPart::ESBP_RightArm, FName("upperarm_r"), FName("hand_r"), 8.f },
+		{ EShooterBodyPart::ESBP_LeftLeg, FName("thigh_l"), FName("foot_l"), 11.f },
+		{ EShooterBodyPart::ESBP_RightLeg, FName("thigh_r"), FName("foot_r"), 11.f }
+	};
+
 }
 
 // Called when the game starts or when spawned
@@ -89,13 +163,102 @@ void AShooterChar::BeginPlay()
 		CameraCurrentFOV = CameraDefaultFOV;
 
 	}
-	//spawn default and equip it 
-	EquipWeapon(SpawnDefaultWeapon());
+	if (UShooterHitboxSubsystem* HitboxSubsystem = UShooterHitboxSubsystem::Get(this)) {
+		HitboxSubsystem->Register(this, Hitboxes);
+	}
+	if (UShooterCrowdSubsystem* Crowd = UShooterCrowdSubsystem::Get(this)) {
+		Crowd->Register(this);
+	}
+
+	//defaults until a weapon is equipped
+	ResolveWeaponData();
+
+	//spawn default and equip it once the class is loaded
+	RequestDefaultWeapon();
+
+}
+
+void AShooterChar::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+
+	InputRecorder.Finish();
+
+	if (UShooterHitboxSubsystem* HitboxSubsystem = UShooterHitboxSubsystem::Get(this)) {
+		HitboxSubsystem->Unregister(this);
+	}
+	if (UShooterCrowdSubsystem* Crowd = UShooterCrowdSubsystem::Get(this)) {
+		Crowd->Unregister(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
 
 }
 
+void AShooterChar::PostLoad()
+{
+
+	Super::PostLoad();
+
+#if WITH_EDITOR
+	MigrateDeprecatedWeaponCosmetics();
+#endif
+
+}
+
+#if WITH_EDITOR
+void AShooterChar::MigrateDeprecatedWeaponCosmetics()
+{
+
+	if (HipFireMontage_DEPRECATED == nullptr && FireSound_DEPRECATED.IsNull() && ParticleEffect_DEPRECATED.IsNull()
+		&& ImpactParticles_DEPRECATED.IsNull() && BeamParticles_DEPRECATED.IsNull()) {
+		return;
+	}
+
+	//the default weapon's data is the one these cosmetics were used with
+	UClass* WeaponClass = DefaultWeaponClass.LoadSynchronous();
+	const AWeapon* Weapon = WeaponClass ? WeaponClass->GetDefaultObject<AWeapon>() : nullptr;
+	UWeaponData* WeaponData = Weapon ? Weapon->GetWeaponData() : nullptr;
+	if (WeaponData == nullptr) {
+		UE_LOG(LogShooter, Error, TEXT("%s: fire montage, sound and particles on the character moved to UWeaponData, but its default weapon has no weapon data to move them to. They are dropped on the next save."),
+			*GetPathName());
+		return;
+	}
+
+	//values already set on the data asset win
+	WeaponData->Modify();
+	if (WeaponData->HipFireMontage.IsNull()) {
+		WeaponData->HipFireMontage = HipFireMontage_DEPRECATED;
+	}
+	if (WeaponData->FireSound.IsNull()) {
+		WeaponData->FireSound = FireSound_DEPRECATED;
+	}
+	if (WeaponData->MuzzleFlash.IsNull()) {
+		WeaponData->MuzzleFlash = ParticleEffect_DEPRECATED;
+	}
+	if (WeaponData->ImpactParticles.IsNull()) {
+		WeaponData->ImpactParticles = ImpactParticles_DEPRECATED;
+	}
+	if (WeaponData->BeamParticles.IsNull()) {
+		WeaponData->BeamParticles = BeamParticles_DEPRECATED;
+	}
+
+	HipFireMontage_DEPRECATED = nullptr;
+	FireSound_DEPRECATED.Reset();
+	ParticleEffect_DEPRECATED.Reset();
+	ImpactParticles_DEPRECATED.Reset();
+	BeamParticles_DEPRECATED.Reset();
+	MarkPackageDirty();
+
+	UE_LOG(LogShooter, Warning, TEXT("%s: moved fire montage, sound and particles into %s, save both"),
+		*GetPathName(),
+		*WeaponData->GetPathName());
+
+}
+#endif
+
 void AShooterChar::MoveForward(float ThisValue)
 {
+	InputRecorder.SetAxis(EShooterInputAxis::ESIA_MoveForward, ThisValue);
 
 	if ((Controller != nullptr) && (ThisValue != 0.0f)) {
 
@@ -112,6 +275,7 @@ void AShooterChar::MoveForward(float ThisValue)
 
 void AShooterChar::MoveRight(float ThisValue)
 {
+	InputRecorder.SetAxis(EShooterInputAxis::ESIA_MoveRight, ThisValue);
 
 	if ((Controller != nullptr) && (ThisValue != 0.0f)) {
 
@@ -128,6 +292,7 @@ void AShooterChar::MoveRight(float ThisValue)
 
 void AShooterChar::TurnAtRate(float rate)
 {
+	InputRecorder.SetAxis(EShooterInputAxis::ESIA_TurnRate, rate);
 
 	AddControllerYawInput(rate * BaseTurnRate * GetWorld()->GetDeltaSeconds());
 
@@ -135,6 +300,7 @@ void AShooterChar::TurnAtRate(float rate)
 
 void AShooterChar::LoopUpAtRate(float rate)
 {
+	InputRecorder.SetAxis(EShooterInputAxis::ESIA_LookUpRate, rate);
 
 	AddControllerPitchInput(rate * BaseLookUpRate * GetWorld()->GetDeltaSeconds());
 
@@ -142,6 +308,7 @@ void AShooterChar::LoopUpAtRate(float rate)
 
 void AShooterChar::Turn(float Value)
 {
+	InputRecorder.SetAxis(EShooterInputAxis::ESIA_Turn, Value);
 
 	float TurnScaleFactor{};
 
@@ -162,6 +329,7 @@ void AShooterChar::Turn(float Value)
 
 void AShooterChar::LookUp(float Value)
 {
+	InputRecorder.SetAxis(EShooterInputAxis::ESIA_LookUp, Value);
 
 	float LookUpScaleFactor{};
 
@@ -180,67 +348,164 @@ void AShooterChar::LookUp(float Value)
 
 }
 
+void AShooterChar::JumpButtonPressed()
+{
+
+	InputRecorder.SetAction(EShooterInputAction::ESIAc_Jump, true);
+	Jump();
+
+}
+
+void AShooterChar::JumpButtonReleased()
+{
+
+	InputRecorder.SetAction(EShooterInputAction::ESIAc_Jump, false);
+	StopJumping();
+
+}
+
+void AShooterChar::ApplyReplayedInput(const FShooterInputFrame& Frame)
+{
+
+	MoveForward(Frame.Axes[(int32)EShooterInputAxis::ESIA_MoveForward]);
+	MoveRight(Frame.Axes[(int32)EShooterInputAxis::ESIA_MoveRight]);
+	TurnAtRate(Frame.Axes[(int32)EShooterInputAxis::ESIA_TurnRate]);
+	LoopUpAtRate(Frame.Axes[(int32)EShooterInputAxis::ESIA_LookUpRate]);
+	Turn(Frame.Axes[(int32)EShooterInputAxis::ESIA_Turn]);
+	LookUp(Frame.Axes[(int32)EShooterInputAxis::ESIA_LookUp]);
+
+	//only edges call the action handlers, like IE_Pressed / IE_Released bindings
+	const uint8 Changed = Frame.HeldActions ^ ReplayHeldActions;
+	auto WasChanged = [Changed](EShooterInputAction Action) { return (Changed & (1 << (int32)Action)) != 0; };
+
+	if (WasChanged(EShooterInputAction::ESIAc_Jump)) {
+		Frame.IsHeld(EShooterInputAction::ESIAc_Jump) ? JumpButtonPressed() : JumpButtonReleased();
+	}
+	if (WasChanged(EShooterInputAction::ESIAc_FireButton)) {
+		Frame.IsHeld(EShooterInputAction::ESIAc_FireButton) ? FireButtonPressed() : FireButtonReleased();
+	}
+	if (WasChanged(EShooterInputAction::ESIAc_AimingButton)) {
+		Frame.IsHeld(EShooterInputAction::ESIAc_AimingButton) ? AimingButtonPressed() : AimingButtonReleased();
+	}
+	if (WasChanged(EShooterInputAction::ESIAc_Select)) {
+		Frame.IsHeld(EShooterInputAction::ESIAc_Select) ? SelectButtonPressed() : SelectButtonReleased();
+	}
+
+	ReplayHeldActions = Frame.HeldActions;
+
+}
+
 void AShooterChar::FireWeapon()
 {
+	SHOOTER_SCOPE_CYCLE_COUNTER(FireWeapon);
+
+	FShooterFrameCounters::Get().NoteEvent(TEXT("FireWeapon"));
+	const UWeaponData* WeaponData = EquipedWeaponData;
+	KillCam->NotifyFired();
 
-	if (FireSound) {
-		UGameplayStatics::PlaySound2D(this, FireSound);
+#if WITH_SHOOTER_COSMETICS
+	if (USoundCue* Sound = WeaponData->FireSound.Get()) {
+		UGameplayStatics::PlaySound2D(this, Sound);
 	}
+#endif
 
-	const USkeletalMeshSocket* BarrelSocket = GetMesh()->GetSocketByName("BarrelSocket");
 	if (BarrelSocket) {
 		const FTransform SocketTransform = BarrelSocket->GetSocketTransform(GetMesh());
 
-		if (ParticleEffect) {
-			UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), ParticleEffect, SocketTransform);
+#if WITH_SHOOTER_COSMETICS
+		if (UParticleSystem* MuzzleFlash = WeaponData->MuzzleFlash.Get()) {
+			UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), MuzzleFlash, SocketTransform);
+			FShooterFrameCounters::Get().AddEmitters();
 		}
+#endif
 
 		FVector BeamEnd;
-		bool bBeamEnd = GetBeamEndLocation(SocketTransform.GetLocation(), BeamEnd);
+		FShooterHitboxHit CharacterHit;
+		FShooterTelemetry::Record(EShooterTelemetryEvent::ESTE_Shot, this, EquipedWeapon, SocketTransform.GetLocation());
+		bool bBeamEnd = GetBeamEndLocation(SocketTransform.GetLocation(), BeamEnd, CharacterHit);
+		FireLatencySample.Mark(EFireLatencyStage::EFLS_Traces);
+
+		UShooterDamageQueue* DamageQueue = UShooterDamageQueue::Get(this);
+		if (DamageQueue && CharacterHit.Character && EquipedWeapon && HasAuthority()) {
+
+			FShooterHitRecord Hit;
+			Hit.Victim = CharacterHit.Character;
+			Hit.Instigator = GetController();
+			Hit.DamageCauser = EquipedWeapon;
+			Hit.BaseDamage = EquipedWeapon->GetDamage();
+			Hit.BodyPart = CharacterHit.BodyPart;
+			Hit.Distance = CharacterHit.Distance;
+			DamageQueue->QueueHit(Hit);
 
+		}
+
+#if WITH_SHOOTER_COSMETICS
 		if (bBeamEnd) {
 
 			//spawn impact particle after update beam end point...
-			if (ImpactParticles) {
+			if (UParticleSystem* Impact = WeaponData->ImpactParticles.Get()) {
 
 				UGameplayStatics::SpawnEmitterAtLocation(GetWorld(),
-					ImpactParticles,
+					Impact,
 					BeamEnd
 				);
+				FShooterFrameCounters::Get().AddEmitters();
 
 			}
 
 			UParticleSystemComponent* Beam = UGameplayStatics::SpawnEmitterAtLocation(
 				GetWorld(),
-				BeamParticles,
+				WeaponData->BeamParticles.Get(),
 				SocketTransform);
 
 			if (Beam) {
 
-				Beam->SetVectorParameter(FName("Target"), BeamEnd);
+				FShooterFrameCounters::Get().AddEmitters();
+				Beam->SetVectorParameter(WeaponData->BeamTargetParameter, BeamEnd);
 
 			}
 		}
+		FireLatencySample.Mark(EFireLatencyStage::EFLS_Emitters);
+#endif
 
 	}
 
 	UAnimInstance* AnimInstance = GetMesh()->GetAnimInstance();
-	if (AnimInstance && HipFireMontage) {
+	UShooterAnimInstance* ShooterAnim = Cast<UShooterAnimInstance>(AnimInstance);
+	UAnimMontage* HipFireMontage = WeaponData->HipFireMontage.Get();
+	if (ShooterAnim && ShooterAnim->UsesProceduralRecoil()) {
+
+		//springs in the anim update instead of a montage instance per round
+		ShooterAnim->AddRecoilImpulse(WeaponData->RecoilPitchImpulse,
+			FMath::FRandRange(-1.f, 1.f) * WeaponData->RecoilYawImpulse,
+			WeaponData->RecoilKickbackImpulse);
+		FireLatencySample.Mark(EFireLatencyStage::EFLS_Montage);
+
+	}
+	else if (AnimInstance && HipFireMontage) {
 
+		const uint32 MontageStartCycles = FPlatformTime::Cycles();
 		AnimInstance->Montage_Play(HipFireMontage);
-		AnimInstance->Montage_JumpToSection(FName("MontageSectionStartFire"));
+		AnimInstance->Montage_JumpToSection(WeaponData->FireMontageSection);
+		UShooterAnimInstance::AddMontageShotCycles(FPlatformTime::Cycles() - MontageStartCycles);
+		FireLatencySample.Mark(EFireLatencyStage::EFLS_Montage);
 
 	}
 
 	StartCrosshairBulletFire();
 
+	FFireLatencyTracker::Get().Submit(FireLatencySample);
+	FireLatencySample.Reset();
+
 }
 
-bool AShooterChar::GetBeamEndLocation(const FVector& MuzzleSocketLocation, FVector& OutBeamLocation)
+bool AShooterChar::GetBeamEndLocation(const FVector& MuzzleSocketLocation, FVector& OutBeamLocation, FShooterHitboxHit& OutCharacterHit)
 {
-	// check for crosshair hit
+	SHOOTER_SCOPE_CYCLE_COUNTER(GetBeamEndLocation);
+
+	// check for crosshair hit, a real shot so it is never deferred
 	FHitResult CrosshairHitResult;
-	bool bCrosshairHit = TraceUndercrosshairs(CrosshairHitResult, OutBeamLocation);
+	bool bCrosshairHit = TraceUndercrosshairs(CrosshairHitResult, OutBeamLocation, EShooterTracePriority::ESTP_Shot);
 
 	if (bCrosshairHit) {
 
@@ -256,17 +521,44 @@ bool AShooterChar::GetBeamEndLocation(const FVector& MuzzleSocketLocation, FVect
 	FHitResult WeaponTraceHit;
 	const FVector WeaponTraceStart{ MuzzleSocketLocation };
 	const FVector StartToEnd{ OutBeamLocation - MuzzleSocketLocation };
-	const FVector WeaponTraceEnd{ MuzzleSocketLocation + StartToEnd * 1.25f };
+	FVector WeaponTraceEnd{ MuzzleSocketLocation + StartToEnd * 1.25f };
+
+	//character hitboxes first, the physics trace then only checks nothing is in the way
+	OutCharacterHit = FShooterHitboxHit();
+	UShooterHitboxSubsystem* HitboxSubsystem = UShooterHitboxSubsystem::Get(this);
+	if (HitboxSubsystem && HitboxSubsystem->RayTest(WeaponTraceStart,
+		StartToEnd.GetSafeNormal(),
+		(WeaponTraceEnd - WeaponTraceStart).Size(),
+		this,
+		OutCharacterHit)) {
 
-	GetWorld()->LineTraceSingleByChannel(
-		WeaponTraceHit,
-		WeaponTraceStart,
-		WeaponTraceEnd,
-		ECollisionChannel::ECC_Visibility);
+		WeaponTraceEnd = OutCharacterHit.Location;
 
+	}
+
+	const ECollisionChannel WeaponTraceChannel = UShooterTraceScheduler::UseLegacyChannels() ? ECollisionChannel::ECC_Visibility : ECC_WeaponFire;
+	if (UShooterTraceScheduler* TraceScheduler = UShooterTraceScheduler::Get(this)) {
+		TraceScheduler->LineTrace(EShooterTracePriority::ESTP_Shot, this, WeaponTraceHit, WeaponTraceStart, WeaponTraceEnd, WeaponTraceChannel);
+	}
+	else {
+		GetWorld()->LineTraceSingleByChannel(WeaponTraceHit, WeaponTraceStart, WeaponTraceEnd, WeaponTraceChannel);
+	}
+
+	//a character's own collision doesn't count as cover, its hitboxes decide
+	const bool bWorldHit = WeaponTraceHit.bBlockingHit && Cast<AShooterChar>(WeaponTraceHit.GetActor()) == nullptr;
+
+	if (OutCharacterHit.Character && !bWorldHit) {
+
+		OutBeamLocation = OutCharacterHit.Location;
+		FShooterTelemetry::Record(EShooterTelemetryEvent::ESTE_Hit, this, OutCharacterHit.Character, OutBeamLocation, (uint8)OutCharacterHit.BodyPart);
+		return true;
+	}
+
+	OutCharacterHit = FShooterHitboxHit();
 	if (WeaponTraceHit.bBlockingHit) {
 
 		OutBeamLocation = WeaponTraceHit.Location;
+		FShooterTelemetry::Record(EShooterTelemetryEvent::ESTE_Impact, this, WeaponTraceHit.GetActor(), OutBeamLocation);
 		return true;
 	}
 	return false;
@@ -275,6 +567,7 @@ bool AShooterChar::GetBeamEndLocation(const FVector& MuzzleSocketLocation, FVect
 
 void AShooterChar::AimingButtonPressed()
 {
+	InputRecorder.SetAction(EShooterInputAction::ESIAc_AimingButton, true);
 
 	bAiming = true;
 
@@ -282,6 +575,7 @@ void AShooterChar::AimingButtonPressed()
 
 void AShooterChar::AimingButtonReleased()
 {
+	InputRecorder.SetAction(EShooterInputAction::ESIAc_AimingButton, false);
 
 	bAiming = false;
 
@@ -310,94 +604,115 @@ void AShooterChar::CameraInterpolationZoom(float DeltaTime)
 	GetFollowCamera()->SetFieldOfView(CameraCurrentFOV);
 }
 
-void AShooterChar::SetLookRates()
+void AShooterChar::RequestDefaultWeapon()
 {
 
-	if (bAiming) {
-		BaseTurnRate = AimingTurnRate;
-		BaseLookUpRate = AimingLookUpRate;
-	}
-	else {
-		BaseTurnRate = HipTurnRate;
-		BaseLookUpRate = HipLookUpRate;
+	if (DefaultWeaponClass.IsNull()) {
+		return;
 	}
 
+	DefaultWeaponRequestSeconds = FPlatformTime::Seconds();
+	DefaultWeaponClassHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(
+		DefaultWeaponClass.ToSoftObjectPath(),
+		FStreamableDelegate::CreateUObject(this, &AShooterChar::OnDefaultWeaponClassLoaded));
+
 }
 
-void AShooterChar::CalculateCrosshairSpread(float DeltaTime)
+void AShooterChar::OnDefaultWeaponClassLoaded()
 {
 
-	FVector2D WalkSpeedRange{ 0.f, 600.f };
-	FVector2D VelocityMultiplierRange{ 0.f , 1.f };
-	FVector Velocity{ GetVelocity() };
-	Velocity.Z = 0.f;
+	UE_LOG(LogShooter, Log, TEXT("%s: default weapon class %s loaded in %.2f ms"),
+		*GetName(),
+		*DefaultWeaponClass.ToString(),
+		(FPlatformTime::Seconds() - DefaultWeaponRequestSeconds) * 1000.0);
 
-	CrosshairVelocityFactor = FMath::GetMappedRangeValueClamped(WalkSpeedRange,
-		VelocityMultiplierRange,
-		Velocity.Size());
+	FShooterFrameCounters::Get().NoteEvent(TEXT("SpawnDefaultWeapon"));
+	EquipWeapon(SpawnDefaultWeapon());
+	//the spawned weapon keeps its class alive
+	DefaultWeaponClassHandle.Reset();
 
-	if (GetCharacterMovement()->IsFalling()) { // is in air? 
+}
 
-		CrosshairInAirFactor = FMath::FInterpTo(
-			CrosshairInAirFactor,
-			2.25f,
-			DeltaTime,
-			2.25f);
+void AShooterChar::ResolveWeaponData()
+{
 
-	}
-	else {
+	UWeaponData* WeaponData = EquipedWeapon ? EquipedWeapon->GetWeaponData() : nullptr;
+	EquipedWeaponData = WeaponData ? WeaponData : GetMutableDefault<UWeaponData>();
 
-		CrosshairInAirFactor = FMath::FInterpTo(
-			CrosshairInAirFactor,
-			0.f,
-			DeltaTime,
-			30.f);
+	BarrelSocket = GetMesh()->GetSocketByName(EquipedWeaponData->BarrelSocketName);
+	AutomaticFireRate = EquipedWeaponData->AutomaticFireRate;
+	ShootTimeDuration = EquipedWeaponData->ShootTimeDuration;
+	ShootingSpread = EquipedWeaponData->ShootingSpread;
+
+}
+
+void AShooterChar::LoadWeaponData()
+{
 
+	WeaponDataHandle.Reset();
+	if (EquipedWeaponData == GetDefault<UWeaponData>()) {
+		return;
 	}
 
-	if (bAiming) {
+	WeaponDataRequestSeconds = FPlatformTime::Seconds();
+	WeaponDataHandle = UAssetManager::Get().LoadPrimaryAsset(EquipedWeaponData->GetPrimaryAssetId(),
+		UWeaponData::GetBundlesToLoad(),
+		FStreamableDelegate::CreateUObject(this, &AShooterChar::OnWeaponDataLoaded));
 
-		CrosshairAimFactor = FMath::FInterpTo(
-			CrosshairAimFactor,
-			0.6f,
-			DeltaTime,
-			30.f);
+}
 
-	}
-	else {
+void AShooterChar::OnWeaponDataLoaded()
+{
 
-		CrosshairAimFactor = FMath::FInterpTo(
-			CrosshairAimFactor,
-			0.f,
-			DeltaTime,
-			30.f);
+	FShooterFrameCounters::Get().NoteEvent(TEXT("WeaponDataLoaded"));
+	UE_LOG(LogShooter, Log, TEXT("%s: weapon data %s loaded in %.2f ms"),
+		*GetName(),
+		*EquipedWeaponData->GetName(),
+		(FPlatformTime::Seconds() - WeaponDataRequestSeconds) * 1000.0);
 
+	//clients pay for the first play of a fire montage here instead of on the first shot
+	if (UShooterWarmUpSubsystem* WarmUp = UShooterWarmUpSubsystem::Get(this)) {
+		WarmUp->PrimeMontage(GetMesh()->GetAnimInstance(), EquipedWeaponData->HipFireMontage.Get());
 	}
 
-	if (bFiringBullet) {
+}
 
-		CrosshairShootingFactor = FMath::FInterpTo(
-			CrosshairShootingFactor,
-			0.3f,
-			DeltaTime,
-			65.f
-		);
+void AShooterChar::SetLookRates()
+{
 
+	if (bAiming) {
+		BaseTurnRate = AimingTurnRate;
+		BaseLookUpRate = AimingLookUpRate;
 	}
 	else {
+		BaseTurnRate = HipTurnRate;
+		BaseLookUpRate = HipLookUpRate;
+	}
 
-		CrosshairShootingFactor = FMath::FInterpTo(
-			CrosshairShootingFactor,
-			0.f,
-			DeltaTime,
-			65.f
-		);
+}
 
-	}
+void AShooterChar::CalculateCrosshairSpread(float DeltaTime)
+{
+	SHOOTER_SCOPE_CYCLE_COUNTER(CalculateCrosshairSpread);
 
-	CrosshairSpreadMultiplier = 0.5f +
-		CrosshairVelocityFactor +
-		CrosshairInAirFactor - CrosshairAimFactor + CrosshairShootingFactor;
+	ShooterCombatCore::FSpreadState Spread;
+	Spread.InAirFactor = CrosshairInAirFactor;
+	Spread.AimFactor = CrosshairAimFactor;
+	Spread.ShootingFactor = CrosshairShootingFactor;
+
+	ShooterCombatCore::FSpreadInput Input;
+	Input.HorizontalSpeed = GetVelocity().Size2D();
+	Input.bFalling = GetCharacterMovement()->IsFalling();
+	Input.bAiming = bAiming;
+	Input.bFiringBullet = bFiringBullet;
+	Input.ShootingSpread = ShootingSpread;
+
+	CrosshairSpreadMultiplier = ShooterCombatCore::StepSpread(Spread, Input, DeltaTime);
+
+	CrosshairVelocityFactor = Spread.VelocityFactor;
+	CrosshairInAirFactor = Spread.InAirFactor;
+	CrosshairAimFactor = Spread.AimFactor;
+	CrosshairShootingFactor = Spread.ShootingFactor;
 
 }
 
@@ -406,6 +721,12 @@ void AShooterChar::StartCrosshairBulletFire()
 
 	bFiringBullet = true;
 
+	if (GShooterCombatTickRate > 0) {
+		//counted down by StepCombat
+		FiringBulletRemaining = ShootTimeDuration;
+		return;
+	}
+
 	GetWorldTimerManager().SetTimer(CrosshairShootTimer,
 		this,
 		&AShooterChar::FinishCrosshairBulletFire,
@@ -422,14 +743,18 @@ void AShooterChar::FinishCrosshairBulletFire()
 
 void AShooterChar::FireButtonPressed()
 {
+	InputRecorder.SetAction(EShooterInputAction::ESIAc_FireButton, true);
 
 	bFireButtonPressed = true;
+	FireLatencySample.Reset();
+	FireLatencySample.Mark(EFireLatencyStage::EFLS_Input);
 	StartFireTimer();
 
 }
 
 void AShooterChar::FireButtonReleased()
 {
+	InputRecorder.SetAction(EShooterInputAction::ESIAc_FireButton, false);
 
 	bFireButtonPressed = false;
 
@@ -439,8 +764,18 @@ void AShooterChar::StartFireTimer()
 {
 
 	if (bShouldFire) {
+		if (!FireLatencySample.IsStarted()) {
+			//held trigger, the automatic fire reset stands in for the click
+			FireLatencySample.Mark(EFireLatencyStage::EFLS_Input);
+		}
+		FireLatencySample.Mark(EFireLatencyStage::EFLS_FireTimer);
 		FireWeapon();
 		bShouldFire = false;
+		if (GShooterCombatTickRate > 0) {
+			//keeps what the last step overshot, so held fire averages exactly AutomaticFireRate
+			FireCooldownRemaining += AutomaticFireRate;
+			return;
+		}
 		GetWorldTimerManager().SetTimer(
 			AutomaticFireTimer,
 			this,
@@ -451,6 +786,56 @@ void AShooterChar::StartFireTimer()
 
 }
 
+void AShooterChar::TickCombat(float DeltaTime)
+{
+
+	const float StepSeconds = 1.f / GShooterCombatTickRate;
+	CombatStepAccumulator += DeltaTime;
+
+	int32 NumSteps = FMath::FloorToInt(CombatStepAccumulator / StepSeconds);
+	if (NumSteps > MaxCombatSubsteps) {
+		UE_LOG(LogShooter, Verbose, TEXT("%s: dropped %d combat steps"), *GetName(), NumSteps - MaxCombatSubsteps);
+		NumSteps = MaxCombatSubsteps;
+		CombatStepAccumulator = NumSteps * StepSeconds;
+	}
+
+	for (int32 Step = 0; Step < NumSteps; Step++) {
+		StepCombat(StepSeconds);
+	}
+	CombatStepAccumulator -= NumSteps * StepSeconds;
+
+#if WITH_SHOOTER_COSMETICS
+	//the crosshair shows where spread is between the last two steps
+	CrosshairSpreadMultiplier = FMath::Lerp(PreviousStepSpreadMultiplier,
+		LatestStepSpreadMultiplier,
+		CombatStepAccumulator / StepSeconds);
+#endif
+
+}
+
+void AShooterChar::StepCombat(float StepSeconds)
+{
+
+	if (bFiringBullet) {
+		FiringBulletRemaining -= StepSeconds;
+		if (FiringBulletRemaining <= 0.f) {
+			FinishCrosshairBulletFire();
+		}
+	}
+
+	if (!bShouldFire && ShooterCombatCore::StepFireCooldown(FireCooldownRemaining, bFireButtonPressed, StepSeconds)) {
+		AutomaticFireReset();
+	}
+
+	//spread only draws the crosshair, shots don't use it
+#if WITH_SHOOTER_COSMETICS
+	PreviousStepSpreadMultiplier = LatestStepSpreadMultiplier;
+	CalculateCrosshairSpread(StepSeconds);
+	LatestStepSpreadMultiplier = CrosshairSpreadMultiplier;
+#endif
+
+}
+
 void AShooterChar::AutomaticFireReset()
 {
 
@@ -461,66 +846,93 @@ void AShooterChar::AutomaticFireReset()
 
 }
 
-bool AShooterChar::TraceUndercrosshairs(FHitResult& OutHitResult, FVector& OutHitLocation)
+bool AShooterChar::TraceUndercrosshairs(FHitResult& OutHitResult, FVector& OutHitLocation, EShooterTracePriority Priority)
 {
+	SHOOTER_SCOPE_CYCLE_COUNTER(TraceUndercrosshairs);
 
-	FVector2D ViewportSize;
-	if (GEngine && GEngine->GameViewport) {
+	//the crosshair sits in the middle of the screen, so its ray is the view ray
+	FVector CrosshairWorldPosition;
+	FVector CrosshairWorldDirection;
+	GetAimRay(CrosshairWorldPosition, CrosshairWorldDirection);
 
-		GEngine->GameViewport->GetViewportSize(ViewportSize);
+	//item focus only needs item boxes close by, everything else aims at what a bullet would hit
+	ECollisionChannel Channel = ECC_WeaponFire;
+	float Range = 50'000.f;
+	if (UShooterTraceScheduler::UseLegacyChannels()) {
+		Channel = ECollisionChannel::ECC_Visibility;
+	}
+	else if (Priority == EShooterTracePriority::ESTP_ItemFocus) {
+		Channel = ECC_Interactable;
+		Range = GShooterItemFocusRange;
+	}
 
+	const FVector Start{ CrosshairWorldPosition };
+	const FVector End{ Start + CrosshairWorldDirection * Range };
+	OutHitLocation = End;
+	//walls block Interactable too, an item behind one is not hit
+	const FCollisionQueryParams Params(SCENE_QUERY_STAT(TraceUndercrosshairs), false, this);
+	if (UShooterTraceScheduler* TraceScheduler = UShooterTraceScheduler::Get(this)) {
+		TraceScheduler->LineTrace(Priority, this, OutHitResult, Start, End, Channel, Params);
+	}
+	else {
+		GetWorld()->LineTraceSingleByChannel(OutHitResult, Start, End, Channel, Params);
 	}
 
-	//Get screen space location of crosshairs
-	FVector2D CrosshairLocation(ViewportSize.X / 2.f, ViewportSize.Y / 2.f);
+	if (OutHitResult.bBlockingHit) {
 
-	FVector CrosshairWorldPosition;
-	FVector CrosshairWorldDirection;
+		OutHitLocation = OutHitResult.Location;
+		return true;
+	}
 
-	//get world position and direction of crosshair
-	bool bScreenToWorld = UGameplayStatics::DeprojectScreenToWorld(UGameplayStatics::GetPlayerController(this, 0),
-		CrosshairLocation, CrosshairWorldPosition, CrosshairWorldDirection);
+	return false;
+}
+
+void AShooterChar::GetAimRay(FVector& OutStart, FVector& OutDirection) const
+{
 
-	if (bScreenToWorld) {
-		const FVector Start{ CrosshairWorldPosition };
-		const FVector End{ Start + CrosshairWorldDirection * 50'000.f };
-		OutHitLocation = End;
-		GetWorld()->LineTraceSingleByChannel(OutHitResult,
-			Start,
-			End,
-			ECollisionChannel::ECC_Visibility);
+	FRotator AimRotation;
+	if (Controller) {
 
-		if (OutHitResult.bBlockingHit) {
+		//player camera for players, pawn eyes for AI, works the same on the server
+		Controller->GetPlayerViewPoint(OutStart, AimRotation);
 
-			OutHitLocation = OutHitResult.Location;
-			return true;
-		}
 	}
+	else {
+
+		GetActorEyesViewPoint(OutStart, AimRotation);
+
+	}
+	OutDirection = AimRotation.Vector();
 
-	return false;
 }
 
 void AShooterChar::TraceForItems()
 {
+	SHOOTER_SCOPE_CYCLE_COUNTER(TraceForItems);
+
+	if (GShooterItemFocusCone != 0) {
+		SetFocusedItem(bShouldTraceForItems ? SelectFocusItem() : nullptr);
+		return;
+	}
 
 	if (bShouldTraceForItems) {
 		FHitResult ItemTraceResult;
 		FVector HitLocation;
-		TraceUndercrosshairs(ItemTraceResult, HitLocation);
+		TraceUndercrosshairs(ItemTraceResult, HitLocation, EShooterTracePriority::ESTP_ItemFocus);
 
 		if (ItemTraceResult.bBlockingHit) {
 
 			TraceHitItem = Cast<AItem>(ItemTraceResult.Actor);
-			if (TraceHitItem && TraceHitItem->GetPickupWidget()) {
+			if (TraceHitItem) {
 
-				TraceHitItem->GetPickupWidget()->SetVisibility(true);
+				TraceHitItem->SetPickupWidgetVisibility(true);
 
 			}
 
 			//we hit an AItem last frame
 			if (TraceHitItemLastFrame) {
 				if (TraceHitItem != TraceHitItemLastFrame) {
-					TraceHitItemLastFrame->GetPickupWidget()->SetVisibility(false);
+					TraceHitItemLastFrame->SetPickupWidgetVisibility(false);
 				}
 			}
 
@@ -531,17 +943,149 @@ void AShooterChar::TraceForItems()
 	else if (TraceHitItemLastFrame) {
 
 		//no longer overlapping any items
-		TraceHitItemLastFrame->GetPickupWidget()->SetVisibility(false);
+		TraceHitItemLastFrame->SetPickupWidgetVisibility(false);
+	}
+
+}
+
+AItem* AShooterChar::SelectFocusItem()
+{
+
+	FVector ViewStart;
+	FVector ViewDirection;
+	GetAimRay(ViewStart, ViewDirection);
+
+	const float MinCos = FMath::Cos(FMath::DegreesToRadians(GShooterItemFocusConeDegrees));
+	const float CosRange = FMath::Max(1.f - MinCos, KINDA_SMALL_NUMBER);
+	const float Range = GShooterItemFocusRange;
+
+	AItem* BestItem = nullptr;
+	FVector BestLocation = FVector::ZeroVector;
+	float BestScore = -MAX_flt;
+	for (int32 i = FocusCandidates.Num() - 1; i >= 0; i--) {
+
+		const FItemFocusCandidate& Candidate = FocusCandidates[i];
+		AItem* Item = Candidate.Item.Get();
+		if (Item == nullptr) {
+			FocusCandidates.RemoveAtSwap(i, 1, false);
+			continue;
+		}
+		if (Item->GetItemState() != EItemState::EIS_PickUp) {
+			continue;
+		}
+
+		const FVector ToItem = Candidate.Location - ViewStart;
+		const float Dist = ToItem.Size();
+		if (Dist > Range || Dist < KINDA_SMALL_NUMBER) {
+			continue;
+		}
+
+		const float Cos = FVector::DotProduct(ViewDirection, ToItem / Dist);
+		if (Cos < MinCos) {
+			continue;
+		}
+
+		//straight ahead beats close by, distance breaks near ties
+		const float Score = (Cos - MinCos) / CosRange - 0.25f * Dist / Range;
+		if (Score > BestScore) {
+			BestScore = Score;
+			BestItem = Item;
+			BestLocation = Candidate.Location;
+		}
+
 	}
 
+	if (BestItem == nullptr) {
+		return nullptr;
+	}
+
+	//in view when the first thing on the way is the item's box, or nothing before its origin; a deferred
+	//trace hands back a result only for nearly the same ray, so never one aimed at another item
+	FHitResult Hit;
+	const ECollisionChannel Channel = UShooterTraceScheduler::UseLegacyChannels() ? ECollisionChannel::ECC_Visibility : ECC_Interactable;
+	const FCollisionQueryParams Params(SCENE_QUERY_STAT(SelectFocusItem), false, this);
+	if (UShooterTraceScheduler* TraceScheduler = UShooterTraceScheduler::Get(this)) {
+		TraceScheduler->LineTrace(EShooterTracePriority::ESTP_ItemFocus, this, Hit, ViewStart, BestLocation, Channel, Params);
+	}
+	else {
+		GetWorld()->LineTraceSingleByChannel(Hit, ViewStart, BestLocation, Channel, Params);
+	}
+	return (!Hit.bBlockingHit || Hit.GetActor() == BestItem) ? BestItem : nullptr;
+
+}
+
+void AShooterChar::SetFocusedItem(AItem* Item)
+{
+
+	TraceHitItem = Item;
+	if (Item == TraceHitItemLastFrame) {
+		return;
+	}
+
+	if (TraceHitItemLastFrame) {
+		TraceHitItemLastFrame->SetPickupWidgetVisibility(false);
+	}
+	if (Item) {
+		Item->SetPickupWidgetVisibility(true);
+	}
+	TraceHitItemLastFrame = Item;
+
+}
+
+void AShooterChar::AddFocusCandidate(AItem* Item)
+{
+
+	const FVector Location = Item->GetCollisionBox()->GetComponentLocation();
+	for (FItemFocusCandidate& Candidate : FocusCandidates) {
+
+		if (Candidate.Item == Item) {
+			Candidate.Location = Location;
+			return;
+		}
+
+	}
+	FocusCandidates.Add(FItemFocusCandidate{ Item, Location });
+
+}
+
+void AShooterChar::RemoveFocusCandidate(AItem* Item)
+{
+
+	FocusCandidates.RemoveAllSwap([Item](const FItemFocusCandidate& Candidate) {
+		return Candidate.Item == Item;
+	});
+
+}
+
+double AShooterChar::TimeItemFocus(bool bConeScored, int32 NumFrames)
+{
+
+	const int32 SavedFocusCone = GShooterItemFocusCone;
+	const bool bSavedShouldTraceForItems = bShouldTraceForItems;
+	GShooterItemFocusCone = bConeScored ? 1 : 0;
+	bShouldTraceForItems = true;
+
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+	for (int32 Frame = 0; Frame < NumFrames; Frame++) {
+		TraceForItems();
+	}
+	const double Us = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles) * 1000.0 / FMath::Max(NumFrames, 1);
+
+	GShooterItemFocusCone = SavedFocusCone;
+	bShouldTraceForItems = bSavedShouldTraceForItems;
+
+	//the focus may be a bench item about to be destroyed, the next TraceForItems picks it again
+	SetFocusedItem(nullptr);
+	return Us;
+
 }
 
 AWeapon* AShooterChar::SpawnDefaultWeapon()
 {
 	//check the tsubclass of char
-	if (DefaultWeaponClass) {
+	if (UClass* WeaponClass = DefaultWeaponClass.Get()) {
 		//spawnweapon
-		return GetWorld()->SpawnActor<AWeapon>(DefaultWeaponClass);
+		return GetWorld()->SpawnActor<AWeapon>(WeaponClass);
 	}
 
 	return nullptr;
@@ -552,6 +1096,8 @@ void AShooterChar::EquipWeapon(AWeapon* WeaponToEquip)
 {
 	if (WeaponToEquip) {
 
+		FShooterFrameCounters::Get().NoteEvent(TEXT("EquipWeapon"));
+
 		//hand socket
 		const USkeletalMeshSocket* HandSocket = GetMesh()->GetSocketByName(FName("RightHandSocket"));
 		//attach to the hand 
@@ -560,6 +1106,9 @@ void AShooterChar::EquipWeapon(AWeapon* WeaponToEquip)
 		}
 		EquipedWeapon = WeaponToEquip;
 		EquipedWeapon->SetItemState(EItemState::EIS_Equipped);
+
+		ResolveWeaponData();
+		LoadWeaponData();
 	}
 
 }
@@ -569,6 +1118,7 @@ void AShooterChar::DropWeapon()
 
 	if (EquipedWeapon) {
 
+		FShooterTelemetry::Record(EShooterTelemetryEvent::ESTE_Drop, this, EquipedWeapon, EquipedWeapon->GetActorLocation());
 		FDetachmentTransformRules DetachementTransformRules(EDetachmentRule::KeepWorld, true);
 		EquipedWeapon->GetItemMesh()->DetachFromComponent(DetachementTransformRules);
 		EquipedWeapon->SetItemState(EItemState::EIS_Falling);
@@ -579,8 +1129,10 @@ void AShooterChar::DropWeapon()
 
 void AShooterChar::SelectButtonPressed()
 {
+	InputRecorder.SetAction(EShooterInputAction::ESIAc_Select, true);
 	if (TraceHitItem) {
 
+		FShooterTelemetry::Record(EShooterTelemetryEvent::ESTE_Pickup, this, TraceHitItem, TraceHitItem->GetActorLocation());
 		auto TraceHitWeapon = Cast<AWeapon>(TraceHitItem);
 		SwapWeapon(TraceHitWeapon);
 	}
@@ -589,6 +1141,7 @@ void AShooterChar::SelectButtonPressed()
 
 void AShooterChar::SelectButtonReleased()
 {
+	InputRecorder.SetAction(EShooterInputAction::ESIAc_Select, false);
 
 
 
@@ -597,6 +1150,7 @@ void AShooterChar::SelectButtonReleased()
 void AShooterChar::SwapWeapon(AWeapon* WeaponToSwap)
 {
 
+	FShooterTelemetry::Record(EShooterTelemetryEvent::ESTE_Swap, this, WeaponToSwap, GetActorLocation());
 	DropWeapon();
 	EquipWeapon(WeaponToSwap);
 	TraceHitItem = nullptr;
@@ -608,11 +1162,38 @@ void AShooterChar::SwapWeapon(AWeapon* WeaponToSwap)
 void AShooterChar::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
-	CameraInterpolationZoom(DeltaTime);
+
+	FShooterInputFrame ReplayedFrame;
+	if (InputRecorder.NextReplayFrame(ReplayedFrame)) {
+		ApplyReplayedInput(ReplayedFrame);
+	}
+
 	SetLookRates();
 
-	CalculateCrosshairSpread(DeltaTime);
+	if (GShooterCombatTickRate > 0) {
+		TickCombat(DeltaTime);
+	}
+	else {
+
+		//a switch from fixed step mode leaves no timer behind to reset these
+		if (!bShouldFire && !GetWorldTimerManager().IsTimerActive(AutomaticFireTimer)) {
+			AutomaticFireReset();
+		}
+		if (bFiringBullet && !GetWorldTimerManager().IsTimerActive(CrosshairShootTimer)) {
+			FinishCrosshairBulletFire();
+		}
+#if WITH_SHOOTER_COSMETICS
+		CalculateCrosshairSpread(DeltaTime);
+#endif
+
+	}
+
+#if WITH_SHOOTER_COSMETICS
+	CameraInterpolationZoom(DeltaTime);
+#endif
 	TraceForItems();
+
+	InputRecorder.EndFrame(DeltaTime);
 }
 
 // Called to bind functionality to input
@@ -629,8 +1210,8 @@ void AShooterChar::SetupPlayerInputComponent(UInputComponent* PlayerInputCompone
 	PlayerInputComponent->BindAxis("Turn", this, &AShooterChar::Turn);
 	PlayerInputComponent->BindAxis("LookUp", this, &AShooterChar::LookUp);
 
-	PlayerInputComponent->BindAction("Jump", IE_Pressed, this, &ACharacter::Jump);
-	PlayerInputComponent->BindAction("Jump", IE_Released, this, &ACharacter::StopJumping);
+	PlayerInputComponent->BindAction("Jump", IE_Pressed, this, &AShooterChar::JumpButtonPressed);
+	PlayerInputComponent->BindAction("Jump", IE_Released, this, &AShooterChar::JumpButtonReleased);
 
 	PlayerInputComponent->BindAction("FireButton", IE_Pressed, this, &AShooterChar::FireButtonPressed);
 	PlayerInputComponent->BindAction("FireButton", IE_Released, this, &AShooterChar::FireButtonReleased);
@@ -641,6 +1222,8 @@ void AShooterChar::SetupPlayerInputComponent(UInputComponent* PlayerInputCompone
 	PlayerInputComponent->BindAction("Select", IE_Pressed, this, &AShooterChar::SelectButtonPressed);
 	PlayerInputComponent->BindAction("Select", IE_Released, this, &AShooterChar::SelectButtonReleased);
 
+	InputRecorder.InitFromCommandLine();
+
 }
 
 float AShooterChar::GetCrosshairSpreadMultiplier() const
@@ -665,3 +1248,134 @@ void AShooterChar::IncrementOverlappedItemCount(int8 Ammount)
 	}
 
 }
+
+static FAutoConsoleCommand CmdBenchCombatCore(
+	TEXT("Shooter.BenchCombatCore"),
+	TEXT("Shooter.BenchCombatCore [Samples=100000]: checks the engine-free combat math against the FMath/FVector versions and times it."),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args) {
+
+		const int32 NumSamples = FMath::Max(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 100000, 1);
+		FRandomStream Stream(4321);
+
+		float MaxInterpError = 0.f;
+		float MaxImpulseError = 0.f;
+		float MaxYawError = 0.f;
+		double CoreMs = 0.0;
+		for (int32 i = 0; i < NumSamples; i++) {
+
+			const float Current = Stream.FRandRange(-5.f, 5.f);
+			const float Target = Stream.FRandRange(-5.f, 5.f);
+			const float DeltaTime = Stream.FRandRange(0.f, 0.1f);
+			const float Speed = Stream.FRandRange(0.f, 70.f);
+			const FVector Forward = Stream.GetUnitVector();
+			const FVector Right = FVector::CrossProduct(FVector::UpVector, Forward).GetSafeNormal();
+			const FVector Velocity = Stream.GetUnitVector() * Stream.FRandRange(0.f, 600.f);
+			const float AimYaw = Stream.FRandRange(-180.f, 180.f);
+
+			const uint64 StartCycles = FPlatformTime::Cycles64();
+			const float CoreInterp = ShooterCombatCore::InterpTo(Current, Target, DeltaTime, Speed);
+			const ShooterCombatCore::FVec3 CoreImpulse = ShooterCombatCore::ThrowImpulse(ShooterCombatCore::FVec3{ Forward.X, Forward.Y, Forward.Z },
+				ShooterCombatCore::FVec3{ Right.X, Right.Y, Right.Z });
+			const float CoreYaw = ShooterCombatCore::MovementOffsetYaw(ShooterCombatCore::FVec3{ Velocity.X, Velocity.Y, Velocity.Z }, AimYaw);
+			CoreMs += FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+
+			const FVector EngineImpulse = Right.RotateAngleAxis(-20.f, Forward).RotateAngleAxis(30.f, FVector::UpVector) * 20'000.f;
+			const float EngineYaw = (Velocity.Rotation() - FRotator(0.f, AimYaw, 0.f)).GetNormalized().Yaw;
+
+			MaxInterpError = FMath::Max(MaxInterpError, FMath::Abs(CoreInterp - FMath::FInterpTo(Current, Target, DeltaTime, Speed)));
+			MaxImpulseError = FMath::Max(MaxImpulseError, FVector::Dist(FVector(CoreImpulse.X, CoreImpulse.Y, CoreImpulse.Z), EngineImpulse));
+			MaxYawError = FMath::Max(MaxYawError, FMath::Abs(FRotator::NormalizeAxis(CoreYaw - EngineYaw)));
+
+		}
+
+		//ten seconds of held trigger at 0.1 s per shot should be 100 shots at any step rate
+		bool bCadenceOk = true;
+		for (const int32 TickRate : { 20, 30, 60, 144 }) {
+
+			float CooldownRemaining = 0.f;
+			bool bReady = true;
+			int32 Shots = 0;
+			for (int32 Step = 0; Step < 10 * TickRate; Step++) {
+
+				if (!bReady && ShooterCombatCore::StepFireCooldown(CooldownRemaining, true, 1.f / TickRate)) {
+					bReady = true;
+				}
+				if (bReady) {
+					Shots++;
+					bReady = false;
+					CooldownRemaining += 0.1f;
+				}
+
+			}
+			UE_LOG(LogShooter, Display, TEXT("  %3d Hz: %d shots in 10 s"), TickRate, Shots);
+			bCadenceOk &= FMath::Abs(Shots - 100) <= 1;
+
+		}
+
+		const bool bPass = MaxInterpError < 1.e-5f && MaxImpulseError < 1.f && MaxYawError < 1.e-2f && bCadenceOk;
+		UE_LOG(LogShooter, Display, TEXT("Combat core bench %s: %d samples, %.1f ns per sample, max error interp %g, impulse %.3f, yaw %.4f deg"),
+			bPass ? TEXT("PASS") : TEXT("FAIL"),
+			NumSamples,
+			CoreMs * 1000000.0 / NumSamples,
+			MaxInterpError,
+			MaxImpulseError,
+			MaxYawError);
+
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs CmdBenchItemFocus(
+	TEXT("Shooter.BenchItemFocus"),
+	TEXT("Shooter.BenchItemFocus [Items=200] [Frames=200]: spawns the items in reach in front of the local pawn and times a cone scored and a crosshair traced item focus update."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World) {
+
+		APlayerController* PlayerController = World ? World->GetFirstPlayerController() : nullptr;
+		AShooterChar* Character = PlayerController ? Cast<AShooterChar>(PlayerController->GetPawn()) : nullptr;
+		if (Character == nullptr) {
+			return;
+		}
+
+		const int32 NumItems = FMath::Max(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 200, 1);
+		const int32 NumFrames = FMath::Max(Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 200, 1);
+
+		//every trace runs, the budget would otherwise hand the crosshair path cached results
+		IConsoleVariable* CVarTraceBudget = IConsoleManager::Get().FindConsoleVariable(TEXT("Shooter.Trace.BudgetPerFrame"));
+		const int32 SavedTraceBudget = CVarTraceBudget ? CVarTraceBudget->GetInt() : 0;
+		if (CVarTraceBudget) {
+			CVarTraceBudget->Set(0, ECVF_SetByConsole);
+		}
+
+		FRandomStream Stream(777);
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		SpawnParams.ObjectFlags |= RF_Transient;
+		const FVector Origin = Character->GetActorLocation();
+		const float Yaw = Character->GetControlRotation().Yaw;
+
+		TArray<AItem*> Items;
+		for (int32 i = 0; i < NumItems; i++) {
+
+			const FVector Offset = FRotator(0.f, Yaw + Stream.FRandRange(-60.f, 60.f), 0.f).Vector() * Stream.FRandRange(150.f, GShooterItemFocusRange * 0.8f);
+			AItem* Item = World->SpawnActor<AItem>(AItem::StaticClass(), Origin + Offset, FRotator::ZeroRotator, SpawnParams);
+			Character->AddFocusCandidate(Item);
+			Items.Add(Item);
+
+		}
+
+		const double ConeUs = Character->TimeItemFocus(true, NumFrames);
+		const double TraceUs = Character->TimeItemFocus(false, NumFrames);
+		UE_LOG(LogShooter, Display, TEXT("Item focus bench, %d items in reach: cone scored %.2f us, crosshair trace %.2f us per update (%d updates)"),
+			NumItems,
+			ConeUs,
+			TraceUs,
+			NumFrames);
+
+		//TimeItemFocus let go of the focus, nothing points at the items any more
+		for (AItem* Item : Items) {
+			Character->RemoveFocusCandidate(Item);
+			Item->Destroy();
+		}
+		if (CVarTraceBudget) {
+			CVarTraceBudget->Set(SavedTraceBudget, ECVF_SetByConsole);
+		}
+
+	}));
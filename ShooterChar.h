@@ -5,6 +5,11 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
 #include "Weapon.h"
+#include "ShooterPerf.h"
+#include "ShooterTraceScheduler.h"
+#include "ShooterInputRecorder.h"
+#include "ShooterHitboxes.h"
+#include "Engine/StreamableManager.h"
 #include "ShooterChar.generated.h"
 
 UCLASS()
@@ -12,14 +17,23 @@ class THELASTSHOOTER_API AShooterChar : public ACharacter
 {
 	GENERATED_BODY()
 
+	//bots drive the same input handlers a player does
+	friend class AShooterBotController;
+	//keeps CrowdIndex and bCrowdDemoted, reads the equipped weapon
+	friend class UShooterCrowdSubsystem;
+
 public:
 	// Sets default values for this character's properties
 	AShooterChar();
 
+	virtual void PostLoad() override;
+
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	void MoveForward(float ThisValue); //Move forward and backwards.
 	void MoveRight(float ThisValue); //Side to side input.
 
@@ -31,11 +45,18 @@ protected:
 
 	void LookUp(float Value);
 
+	void JumpButtonPressed();
+	void JumpButtonReleased();
+
+	//feeds a recorded frame through the same handlers the input component calls
+	void ApplyReplayedInput(const FShooterInputFrame& Frame);
+
 
 	// Called when the fire button is pressed.
 	void FireWeapon();
 
-	bool GetBeamEndLocation(const FVector& MuzzleSocketLocation, FVector& OutBeamLocation);
+	//OutCharacterHit is filled when the shot ends in another character's hitbox
+	bool GetBeamEndLocation(const FVector& MuzzleSocketLocation, FVector& OutBeamLocation, FShooterHitboxHit& OutCharacterHit);
 
 	/**Set bAiming to true of false */
 	void AimingButtonPressed();
@@ -43,6 +64,20 @@ protected:
 	void CameraInterpolationZoom(float DeltaTime);
 	void SetLookRates();
 
+	//async loads the default weapon class, spawns and equips it once it is in
+	void RequestDefaultWeapon();
+	void OnDefaultWeaponClassLoaded();
+
+#if WITH_EDITOR
+	//moves the deprecated character cosmetics into the default weapon's data asset
+	void MigrateDeprecatedWeaponCosmetics();
+#endif
+	//picks up fire rate, spread, socket and names from the equipped weapon's data, once per equip
+	void ResolveWeaponData();
+	//async loads the bundles of the equipped weapon's data asset
+	void LoadWeaponData();
+	void OnWeaponDataLoaded();
+
 
 	void CalculateCrosshairSpread(float DeltaTime);
 
@@ -59,10 +94,20 @@ protected:
 	UFUNCTION()
 	void AutomaticFireReset();
 
-	bool TraceUndercrosshairs(FHitResult& OutHitResult, FVector& OutHitLocation);
+	//Shooter.Combat.TickRate > 0: runs as many fixed combat steps as DeltaTime covers
+	void TickCombat(float DeltaTime);
+	//spread, firing state and fire cadence advanced by exactly one step
+	void StepCombat(float StepSeconds);
+
+	bool TraceUndercrosshairs(FHitResult& OutHitResult, FVector& OutHitLocation, EShooterTracePriority Priority);
 
 	void TraceForItems();
 
+	//best focus candidate by view angle and distance, then one short Interactable trace to it
+	AItem* SelectFocusItem();
+	//pickup widgets are only touched when the focus moves to another item
+	void SetFocusedItem(AItem* Item);
+
 	//Spawn weapon and equip it 
 	class AWeapon* SpawnDefaultWeapon();
 	//takes a weapon and attaches it to the mesh 
@@ -93,6 +138,10 @@ private:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera, meta = (AllowPrivateAccess = "true"))
 	class UCameraComponent* FollowCamera;
 
+	/** Last seconds of this char, quantized, for the kill-cam of whoever it kills */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Combat, meta = (AllowPrivateAccess = "true"))
+	class UShooterKillCamComponent* KillCam;
+
 	/** Base turn rate. */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera, meta = (AllowPrivateAccess = "true"))
 	float BaseTurnRate;
@@ -134,27 +183,48 @@ private:
 	float MouseAimingLookUpRate; 
 
 
-	/** Montage fire weapon*/
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true"))
-	class UAnimMontage* HipFireMontage;
+	//data of the equipped weapon, the UWeaponData defaults while nothing is equipped
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Combat, meta = (AllowPrivateAccess = "true"))
+	class UWeaponData* EquipedWeaponData;
+
+#if WITH_EDITORONLY_DATA
+	//moved to UWeaponData; loaded from characters saved before that and moved into the default
+	//weapon's data in PostLoad, never saved again
+	UPROPERTY()
+	class UAnimMontage* HipFireMontage_DEPRECATED;
+
+	UPROPERTY()
+	TSoftObjectPtr<class USoundCue> FireSound_DEPRECATED;
+
+	UPROPERTY()
+	TSoftObjectPtr<class UParticleSystem> ParticleEffect_DEPRECATED;
+
+	UPROPERTY()
+	TSoftObjectPtr<UParticleSystem> ImpactParticles_DEPRECATED;
 
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true"))
-	class USoundCue* FireSound; 
+	UPROPERTY()
+	TSoftObjectPtr<UParticleSystem> BeamParticles_DEPRECATED;
+#endif
 
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true"))
-	class UParticleSystem* ParticleEffect;
+	//BarrelSocketName resolved on equip, owned by the mesh
+	const class USkeletalMeshSocket* BarrelSocket;
 
-	//Particles spawn in fire weapon
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true"))
-	UParticleSystem* ImpactParticles; 
+	//keeps the bundles of EquipedWeaponData loaded
+	TSharedPtr<FStreamableHandle> WeaponDataHandle;
 
-	//smoke trail for bullets.
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true"))
-	UParticleSystem* BeamParticles;
+	TSharedPtr<FStreamableHandle> DefaultWeaponClassHandle;
+
+	//for the load time log lines
+	double DefaultWeaponRequestSeconds;
+	double WeaponDataRequestSeconds;
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Combat, meta = (AllowPrivateAccess = "true"))
 	bool bAiming;
 
+	//capsules shots are tested against, updated from the mesh bones
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Combat, meta = (AllowPrivateAccess = "true"))
+	TArray<FShooterHitboxDef> Hitboxes;
+
 	/** Default camera FOV */
 	float CameraDefaultFOV;
 
@@ -184,6 +254,7 @@ private:
 
 
 	float ShootTimeDuration;
+	float ShootingSpread;
 	bool bFiringBullet;
 	FTimerHandle CrosshairShootTimer;
 
@@ -192,11 +263,40 @@ private:
 	float AutomaticFireRate; 
 	FTimerHandle AutomaticFireTimer; 
 
+	//fixed step combat: time not simulated yet, and the countdowns standing in for the two timers above
+	float CombatStepAccumulator;
+	float FireCooldownRemaining;
+	float FiringBulletRemaining;
+
+	//spread after the previous and the latest step, CrosshairSpreadMultiplier blends between them
+	float PreviousStepSpreadMultiplier;
+	float LatestStepSpreadMultiplier;
+
+	//timestamps of the shot currently going through the fire path
+	FFireLatencySample FireLatencySample;
+
+	FShooterInputRecorder InputRecorder;
+
+	//actions held in the last replayed frame
+	uint8 ReplayHeldActions;
+
+	//slot in the crowd subsystem's arrays
+	int32 CrowdIndex;
+	bool bCrowdDemoted;
+
 
 	bool bShouldTraceForItems;
 
 	int8 OverlappedItemCount;
 
+	//items whose area sphere we are in, with the focus box location from when we entered
+	struct FItemFocusCandidate
+	{
+		TWeakObjectPtr<AItem> Item;
+		FVector Location;
+	};
+	TArray<FItemFocusCandidate> FocusCandidates;
+
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Items, meta = (AllowPrivateAccess = true ))
 	class AItem* TraceHitItemLastFrame;
 
@@ -204,9 +304,9 @@ private:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Combat, meta = (AllowPrivateAccess = true ))
 	AWeapon* EquipedWeapon; 
 
-	//default weapon 
+	//default weapon, soft so its mesh is not loaded with the map
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Combat, meta = (AllowPrivateAccess = true ))
-	TSubclassOf<AWeapon> DefaultWeaponClass; 
+	TSoftClassPtr<AWeapon> DefaultWeaponClass; 
 
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Combat, meta = (AllowPrivateAccess = true ))
@@ -221,6 +321,16 @@ public:
 
 	FORCEINLINE bool GetAiming() const { return bAiming; }
 
+	//trigger held or the last shot's crosshair kick still running
+	FORCEINLINE bool IsFiring() const { return bFireButtonPressed || bFiringBullet; }
+
+	FORCEINLINE AWeapon* GetEquipedWeapon() const { return EquipedWeapon; }
+
+	FORCEINLINE UShooterKillCamComponent* GetKillCam() const { return KillCam; }
+
+	//too far from every player to be a full actor, see UShooterCrowdSubsystem
+	FORCEINLINE bool IsCrowdDemoted() const { return bCrowdDemoted; }
+
 
 	UFUNCTION(BlueprintCallable)
 	float GetCrosshairSpreadMultiplier() const; 
@@ -229,4 +339,14 @@ public:
 
 	void IncrementOverlappedItemCount(int8 Ammount);
 
+	//kept by the items' area sphere overlaps
+	void AddFocusCandidate(AItem* Item);
+	void RemoveFocusCandidate(AItem* Item);
+
+	//average microseconds of one item focus update, cone scored or crosshair trace, for Shooter.BenchItemFocus
+	double TimeItemFocus(bool bConeScored, int32 NumFrames);
+
+	//ray through the crosshair from this character's own controller view, no viewport involved
+	void GetAimRay(FVector& OutStart, FVector& OutDirection) const;
+
 };
\ No newline at end of file
@@ -0,0 +1,195 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include <cmath>
+
+/**
+ * Combat math with no engine dependency: crosshair spread, the weapon throw impulse, the movement
+ * offset yaw of the anim instance and fixed step fire cadence. Plain floats and <cmath> only; the
+ * engine classes convert their FVectors at the call. CombatCore/CMakeLists.txt builds the tests
+ * and micro-benchmarks without the engine, Shooter.BenchCombatCore checks the results in game
+ * against the FMath/FVector/Kismet functions used before.
+ */
+namespace ShooterCombatCore
+{
+	struct FVec3
+	{
+		float X = 0.f;
+		float Y = 0.f;
+		float Z = 0.f;
+	};
+
+	constexpr float Pi = 3.14159265358979323846f;
+
+	inline float Clamp(float Value, float Min, float Max)
+	{
+		return Value < Min ? Min : (Value < Max ? Value : Max);
+	}
+
+	//same as FMath::FInterpTo
+	inline float InterpTo(float Current, float Target, float DeltaTime, float InterpSpeed)
+	{
+
+		if (InterpSpeed <= 0.f) {
+			return Target;
+		}
+
+		const float Dist = Target - Current;
+		if (Dist * Dist < 1.e-8f) {
+			return Target;
+		}
+
+		return Current + Dist * Clamp(DeltaTime * InterpSpeed, 0.f, 1.f);
+
+	}
+
+	//same as FMath::GetMappedRangeValueClamped
+	inline float MapRangeClamped(float InMin, float InMax, float OutMin, float OutMax, float Value)
+	{
+
+		const float Divisor = InMax - InMin;
+		const float Pct = Divisor == 0.f ? (Value >= InMax ? 1.f : 0.f) : Clamp((Value - InMin) / Divisor, 0.f, 1.f);
+		return OutMin + Pct * (OutMax - OutMin);
+
+	}
+
+	//same as FRotator::NormalizeAxis, into (-180, 180]
+	inline float NormalizeAxis(float Degrees)
+	{
+
+		Degrees = std::fmod(Degrees, 360.f);
+		if (Degrees < 0.f) {
+			Degrees += 360.f;
+		}
+		if (Degrees > 180.f) {
+			Degrees -= 360.f;
+		}
+		return Degrees;
+
+	}
+
+	//same as FVector::RotateAngleAxis, Axis must be normalized
+	inline FVec3 RotateAngleAxis(const FVec3& V, float AngleDegrees, const FVec3& Axis)
+	{
+
+		const float S = std::sin(AngleDegrees * Pi / 180.f);
+		const float C = std::cos(AngleDegrees * Pi / 180.f);
+		const float OMC = 1.f - C;
+
+		const float XX = Axis.X * Axis.X;
+		const float YY = Axis.Y * Axis.Y;
+		const float ZZ = Axis.Z * Axis.Z;
+		const float XY = Axis.X * Axis.Y;
+		const float YZ = Axis.Y * Axis.Z;
+		const float ZX = Axis.Z * Axis.X;
+		const float XS = Axis.X * S;
+		const float YS = Axis.Y * S;
+		const float ZS = Axis.Z * S;
+
+		return FVec3{
+			(OMC * XX + C) * V.X + (OMC * XY - ZS) * V.Y + (OMC * ZX + YS) * V.Z,
+			(OMC * XY + ZS) * V.X + (OMC * YY + C) * V.Y + (OMC * YZ - XS) * V.Z,
+			(OMC * ZX - YS) * V.X + (OMC * YZ + XS) * V.Y + (OMC * ZZ + C) * V.Z
+		};
+
+	}
+
+	/** Crosshair spread, the four factors AShooterChar shows in its Crosshairs category */
+	struct FSpreadState
+	{
+		float VelocityFactor = 0.f;
+		float InAirFactor = 0.f;
+		float AimFactor = 0.f;
+		float ShootingFactor = 0.f;
+	};
+
+	struct FSpreadInput
+	{
+		float HorizontalSpeed = 0.f;
+		bool bFalling = false;
+		bool bAiming = false;
+		bool bFiringBullet = false;
+		float ShootingSpread = 0.f; // weapon's spread while firing
+	};
+
+	//advances the factors by DeltaTime and returns the spread multiplier
+	inline float StepSpread(FSpreadState& State, const FSpreadInput& Input, float DeltaTime)
+	{
+
+		State.VelocityFactor = MapRangeClamped(0.f, 600.f, 0.f, 1.f, Input.HorizontalSpeed);
+
+		//spread opens slowly in the air and closes fast on landing
+		State.InAirFactor = Input.bFalling ?
+			InterpTo(State.InAirFactor, 2.25f, DeltaTime, 2.25f) :
+			InterpTo(State.InAirFactor, 0.f, DeltaTime, 30.f);
+
+		State.AimFactor = InterpTo(State.AimFactor, Input.bAiming ? 0.6f : 0.f, DeltaTime, 30.f);
+		State.ShootingFactor = InterpTo(State.ShootingFactor, Input.bFiringBullet ? Input.ShootingSpread : 0.f, DeltaTime, 65.f);
+
+		return 0.5f + State.VelocityFactor + State.InAirFactor - State.AimFactor + State.ShootingFactor;
+
+	}
+
+	//impulse that tosses a dropped weapon out to the mesh's right, tilted up and turned by YawDegrees
+	inline FVec3 ThrowImpulse(const FVec3& MeshForward, const FVec3& MeshRight, float YawDegrees = 30.f, float Strength = 20'000.f)
+	{
+
+		FVec3 Direction = RotateAngleAxis(MeshRight, -20.f, MeshForward);
+		Direction = RotateAngleAxis(Direction, YawDegrees, FVec3{ 0.f, 0.f, 1.f });
+		return FVec3{ Direction.X * Strength, Direction.Y * Strength, Direction.Z * Strength };
+
+	}
+
+	//yaw of the velocity relative to the aim, what the strafe blend space takes
+	inline float MovementOffsetYaw(const FVec3& Velocity, float AimYaw)
+	{
+
+		const float MovementYaw = std::atan2(Velocity.Y, Velocity.X) * 180.f / Pi;
+		return NormalizeAxis(MovementYaw - AimYaw);
+
+	}
+
+	/** Damped spring pulled back to zero, impulses go into Velocity */
+	struct FSpring
+	{
+		float Value = 0.f;
+		float Velocity = 0.f;
+	};
+
+	//semi-implicit Euler, substepped to 240 Hz so a long frame does not blow the spring up
+	inline void StepSpring(FSpring& Spring, float Stiffness, float DampingRatio, float DeltaTime)
+	{
+
+		const float Damping = 2.f * DampingRatio * std::sqrt(Stiffness);
+		const int NumSteps = (int)Clamp(std::ceil(DeltaTime * 240.f), 1.f, 16.f);
+		const float Step = DeltaTime / static_cast<float>(NumSteps);
+		for (int i = 0; i < NumSteps; i++) {
+
+			Spring.Velocity += (-Stiffness * Spring.Value - Damping * Spring.Velocity) * Step;
+			Spring.Value += Spring.Velocity * Step;
+
+		}
+
+	}
+
+	/**
+	 * One fixed step of automatic fire cooldown. Returns true when the weapon is ready again. A held
+	 * trigger keeps what the step overshot, so the next cooldown (CooldownRemaining += FireInterval
+	 * on the shot) comes out that much shorter and the average cadence is exact.
+	 */
+	inline bool StepFireCooldown(float& CooldownRemaining, bool bTriggerHeld, float StepSeconds)
+	{
+
+		CooldownRemaining -= StepSeconds;
+		if (CooldownRemaining > 0.f) {
+			return false;
+		}
+
+		if (!bTriggerHeld) {
+			CooldownRemaining = 0.f;
+		}
+		return true;
+
+	}
+}
@@ -0,0 +1,509 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterCrowdSubsystem.h"
+#include "TheLastShooter.h"
+#include "ShooterChar.h"
+#include "Weapon.h"
+#include "AIController.h"
+#include "NavigationSystem.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "Engine/StaticMesh.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Components/CapsuleComponent.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "Async/ParallelFor.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("CrowdUpdate"), STAT_CrowdUpdate, STATGROUP_TheLastShooter);
+
+static int32 GShooterCrowdEnabled = 1;
+static FAutoConsoleVariableRef CVarShooterCrowdEnabled(
+	TEXT("Shooter.Crowd.Enabled"),
+	GShooterCrowdEnabled,
+	TEXT("1 = bots and remote players far from every player view drop to the lightweight crowd representation, 0 = everybody stays a full actor."));
+
+static float GShooterCrowdPromoteRadius = 5000.f;
+static FAutoConsoleVariableRef CVarShooterCrowdPromoteRadius(
+	TEXT("Shooter.Crowd.PromoteRadius"),
+	GShooterCrowdPromoteRadius,
+	TEXT("Characters inside this distance of a player view are full actors, demotion starts 20% farther out."));
+
+static int32 GShooterCrowdMovementLOD = 1;
+static FAutoConsoleVariableRef CVarShooterCrowdMovementLOD(
+	TEXT("Shooter.Crowd.MovementLOD"),
+	GShooterCrowdMovementLOD,
+	TEXT("1 = full actor bots and remote players out of combat beyond Shooter.Crowd.MovementLODRadius run reduced movement, 0 = full movement for every full actor."));
+
+static float GShooterCrowdMovementLODRadius = 2500.f;
+static FAutoConsoleVariableRef CVarShooterCrowdMovementLODRadius(
+	TEXT("Shooter.Crowd.MovementLODRadius"),
+	GShooterCrowdMovementLODRadius,
+	TEXT("Characters inside this distance of a player view run full movement, reduced movement starts 20% farther out."));
+
+//movement tick of a character on reduced movement
+static const float ReducedMovementTickInterval = 1.f / 15.f;
+
+//demote only this much farther out than the promote radius, so characters on the edge don't flip every frame
+static const float DemoteHysteresis = 1.2f;
+
+//dead reckoned bots are written back to their actor every this many frames, staggered by index
+static const int32 WriteBackFrames = 8;
+
+//a dead reckoned bot's velocity halves every this many seconds, it stops soon after losing its path
+static const float VelocityHalfLife = 1.f;
+
+//below this many characters ParallelFor costs more than it saves
+static const int32 MinParallelCharacters = 64;
+
+//bots on the server, simulated proxies on a client; never a player's own pawn
+static bool CanDemote(const AShooterChar* Character)
+{
+
+	if (Character->HasAuthority()) {
+		return !Character->IsPlayerControlled();
+	}
+	return Character->GetLocalRole() == ROLE_SimulatedProxy;
+
+}
+
+UShooterCrowdSubsystem* UShooterCrowdSubsystem::Get(const UObject* WorldContextObject)
+{
+
+	UWorld* World = GEngine ? GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::LogAndReturnNull) : nullptr;
+	return World ? World->GetSubsystem<UShooterCrowdSubsystem>() : nullptr;
+
+}
+
+void UShooterCrowdSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+
+	Super::Initialize(Collection);
+	PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &UShooterCrowdSubsystem::OnWorldPostActorTick);
+
+#if WITH_SHOOTER_COSMETICS
+	//with the map, rather than on the first demotion
+	if (!IsRunningDedicatedServer()) {
+		ProxyMesh.LoadSynchronous();
+	}
+#endif
+
+}
+
+void UShooterCrowdSubsystem::Deinitialize()
+{
+
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+
+	Characters.Reset();
+	Locations.Reset();
+	Velocities.Reset();
+	SettledLocations.Reset();
+	AimRotations.Reset();
+	Weapons.Reset();
+	DistSquared.Reset();
+	HalfHeights.Reset();
+	bDemoted.Reset();
+	bDeadReckoned.Reset();
+	bReducedMovement.Reset();
+	ProxyInstances.Reset();
+	InstanceOwners.Reset();
+	ProxyComponent = nullptr;
+	HostActor = nullptr;
+
+	Super::Deinitialize();
+
+}
+
+void UShooterCrowdSubsystem::Register(AShooterChar* Character)
+{
+
+	if (Character->CrowdIndex != INDEX_NONE) {
+		return;
+	}
+
+	Character->CrowdIndex = Characters.Add(Character);
+	Locations.Add(Character->GetActorLocation());
+	Velocities.Add(FVector::ZeroVector);
+	SettledLocations.Add(Character->GetActorLocation());
+	AimRotations.Add(Character->GetActorRotation());
+	Weapons.Add(nullptr);
+	DistSquared.Add(0.f);
+	HalfHeights.Add(Character->GetCapsuleComponent()->GetScaledCapsuleHalfHeight());
+	bDemoted.Add(false);
+	bDeadReckoned.Add(false);
+	bReducedMovement.Add(false);
+	ProxyInstances.Add(INDEX_NONE);
+
+}
+
+void UShooterCrowdSubsystem::Unregister(AShooterChar* Character)
+{
+
+	const int32 Index = Character->CrowdIndex;
+	if (!Characters.IsValidIndex(Index)) {
+		return;
+	}
+
+	RemoveProxyInstance(Index);
+	Character->CrowdIndex = INDEX_NONE;
+	Character->bCrowdDemoted = false;
+
+	Characters.RemoveAtSwap(Index, 1, false);
+	Locations.RemoveAtSwap(Index, 1, false);
+	Velocities.RemoveAtSwap(Index, 1, false);
+	SettledLocations.RemoveAtSwap(Index, 1, false);
+	AimRotations.RemoveAtSwap(Index, 1, false);
+	Weapons.RemoveAtSwap(Index, 1, false);
+	DistSquared.RemoveAtSwap(Index, 1, false);
+	HalfHeights.RemoveAtSwap(Index, 1, false);
+	bDemoted.RemoveAtSwap(Index, 1, false);
+	bDeadReckoned.RemoveAtSwap(Index, 1, false);
+	bReducedMovement.RemoveAtSwap(Index, 1, false);
+	ProxyInstances.RemoveAtSwap(Index, 1, false);
+
+	//the last character moved into the hole
+	if (Characters.IsValidIndex(Index)) {
+
+		if (AShooterChar* Moved = Characters[Index].Get()) {
+			Moved->CrowdIndex = Index;
+		}
+		if (ProxyInstances[Index] != INDEX_NONE) {
+			InstanceOwners[ProxyInstances[Index]] = Index;
+		}
+
+	}
+
+}
+
+void UShooterCrowdSubsystem::OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+
+	if (World != GetWorld() || Characters.Num() == 0) {
+		return;
+	}
+
+	SHOOTER_SCOPE_CYCLE_COUNTER(CrowdUpdate);
+	const uint32 StartCycles = FPlatformTime::Cycles();
+	UpdateFrame++;
+
+	//full actors are the source of truth, and so is replication for demoted proxies
+	for (int32 i = 0; i < Characters.Num(); i++) {
+
+		const AShooterChar* Character = Characters[i].Get();
+		if (Character == nullptr) {
+			continue;
+		}
+
+		if (!bDemoted[i] || !bDeadReckoned[i]) {
+			Locations[i] = Character->GetActorLocation();
+			Velocities[i] = Character->GetVelocity();
+			AimRotations[i] = Character->GetBaseAimRotation();
+		}
+		Weapons[i] = Character->EquipedWeapon;
+
+	}
+
+	TArray<FVector> ViewLocations;
+	if (!bIgnorePlayerViews) {
+		ShooterWorld::GetPlayerViewLocations(World, ViewLocations);
+	}
+	const float VelocityDecay = FMath::Pow(0.5f, DeltaSeconds / VelocityHalfLife);
+	ParallelFor(Characters.Num(), [this, &ViewLocations, DeltaSeconds, VelocityDecay](int32 i) {
+
+		if (bDemoted[i] && bDeadReckoned[i]) {
+			Locations[i] += Velocities[i] * DeltaSeconds;
+			Velocities[i] *= VelocityDecay;
+		}
+		DistSquared[i] = ShooterWorld::GetDistSquaredToNearest(Locations[i], ViewLocations);
+
+	}, Characters.Num() < MinParallelCharacters);
+
+	const float PromoteDistSquared = FMath::Square(GShooterCrowdPromoteRadius);
+	const float DemoteDistSquared = FMath::Square(GShooterCrowdPromoteRadius * DemoteHysteresis);
+	const float FullMovementDistSquared = FMath::Square(GShooterCrowdMovementLODRadius);
+	const float ReducedMovementDistSquared = FMath::Square(GShooterCrowdMovementLODRadius * DemoteHysteresis);
+	int32 NumDemoted = 0;
+	NumReducedMovement = 0;
+	for (int32 i = 0; i < Characters.Num(); i++) {
+
+		AShooterChar* Character = Characters[i].Get();
+		if (Character == nullptr) {
+			continue;
+		}
+
+		const bool bCanDemote = GShooterCrowdEnabled != 0 && CanDemote(Character);
+		if (bDemoted[i] && (!bCanDemote || DistSquared[i] < PromoteDistSquared)) {
+			Promote(i);
+		}
+		else if (!bDemoted[i] && bCanDemote && DistSquared[i] > DemoteDistSquared) {
+			Demote(i);
+		}
+
+		if (!bDemoted[i]) {
+
+			//in combat means full movement at any distance, a reduced shooter would aim off a coarse floor
+			const bool bCanReduce = GShooterCrowdMovementLOD != 0 && CanDemote(Character) && !Character->IsFiring() && !Character->GetAiming();
+			if (bReducedMovement[i] && (!bCanReduce || DistSquared[i] < FullMovementDistSquared)) {
+				bReducedMovement[i] = false;
+				SetReducedMovement(Character, false);
+			}
+			else if (!bReducedMovement[i] && bCanReduce && DistSquared[i] > ReducedMovementDistSquared) {
+				bReducedMovement[i] = true;
+				SetReducedMovement(Character, true);
+			}
+			NumReducedMovement += bReducedMovement[i];
+			continue;
+
+		}
+		NumDemoted++;
+
+		//keeps hitboxes, replication and the server's view of the bot roughly where the arrays have it
+		if (bDeadReckoned[i] && (UpdateFrame + i) % WriteBackFrames == 0) {
+			Character->SetActorLocation(SnapToNavigation(i), false, nullptr, ETeleportType::TeleportPhysics);
+		}
+
+	}
+
+	UpdateProxyInstances();
+
+	LastUpdateMs = FPlatformTime::ToMilliseconds(FPlatformTime::Cycles() - StartCycles);
+	CSV_CUSTOM_STAT(TheLastShooter, CrowdDemoted, NumDemoted, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(TheLastShooter, CrowdReducedMovement, NumReducedMovement, ECsvCustomStatOp::Set);
+
+}
+
+void UShooterCrowdSubsystem::Demote(int32 Index)
+{
+
+	AShooterChar* Character = Characters[Index].Get();
+	bDemoted[Index] = true;
+	bDeadReckoned[Index] = Character->HasAuthority();
+	SettledLocations[Index] = Locations[Index];
+	Character->bCrowdDemoted = true;
+
+	if (bDeadReckoned[Index]) {
+
+		//the arrays carry the bot on from here, its path following has no movement to drive
+		if (AAIController* AIController = Cast<AAIController>(Character->GetController())) {
+			AIController->StopMovement();
+		}
+
+	}
+
+	SetFullUpdate(Character, false);
+
+	if (UInstancedStaticMeshComponent* Component = GetProxyComponent()) {
+
+		ProxyInstances[Index] = Component->AddInstanceWorldSpace(FTransform(FRotator(0.f, AimRotations[Index].Yaw, 0.f), Locations[Index] - FVector(0.f, 0.f, HalfHeights[Index])));
+		check(ProxyInstances[Index] == InstanceOwners.Num());
+		InstanceOwners.Add(Index);
+
+	}
+
+}
+
+void UShooterCrowdSubsystem::Promote(int32 Index)
+{
+
+	AShooterChar* Character = Characters[Index].Get();
+	if (bDeadReckoned[Index]) {
+		Character->SetActorLocation(SnapToNavigation(Index), false, nullptr, ETeleportType::TeleportPhysics);
+	}
+
+	bDemoted[Index] = false;
+	bDeadReckoned[Index] = false;
+	Character->bCrowdDemoted = false;
+
+	SetFullUpdate(Character, true);
+	RemoveProxyInstance(Index);
+
+}
+
+FVector UShooterCrowdSubsystem::SnapToNavigation(int32 Index)
+{
+
+	const UNavigationSystemV1* NavSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	const FVector HalfHeight(0.f, 0.f, HalfHeights[Index]);
+
+	//straight line from the last settled point, cut short where it leaves the navmesh
+	FVector Target = Locations[Index] - HalfHeight;
+	FVector HitLocation;
+	if (NavSystem && UNavigationSystemV1::NavigationRaycast(GetWorld(), SettledLocations[Index] - HalfHeight, Target, HitLocation)) {
+		Target = HitLocation;
+		Velocities[Index] = FVector::ZeroVector;
+	}
+
+	FNavLocation NavLocation;
+	if (NavSystem == nullptr || !NavSystem->ProjectPointToNavigation(Target, NavLocation)) {
+
+		//nowhere safe to go, stay put until promoted
+		Velocities[Index] = FVector::ZeroVector;
+		Locations[Index] = SettledLocations[Index];
+		return SettledLocations[Index];
+
+	}
+
+	SettledLocations[Index] = NavLocation.Location + HalfHeight;
+	Locations[Index] = SettledLocations[Index];
+	return SettledLocations[Index];
+
+}
+
+void UShooterCrowdSubsystem::SetFullUpdate(AShooterChar* Character, bool bFull)
+{
+
+	Character->SetActorTickEnabled(bFull);
+	Character->GetCharacterMovement()->SetComponentTickEnabled(bFull);
+	Character->GetMesh()->SetComponentTickEnabled(bFull);
+
+#if WITH_SHOOTER_COSMETICS
+	//component visibility is local, actor hidden would replicate to every client
+	Character->GetMesh()->SetVisibility(bFull);
+	if (AWeapon* Weapon = Character->EquipedWeapon) {
+		Weapon->GetItemMesh()->SetVisibility(bFull);
+	}
+#endif
+
+}
+
+void UShooterCrowdSubsystem::SetReducedMovement(AShooterChar* Character, bool bReduced)
+{
+
+	UCharacterMovementComponent* Movement = Character->GetCharacterMovement();
+	const UCharacterMovementComponent* Defaults = Character->GetClass()->GetDefaultObject<AShooterChar>()->GetCharacterMovement();
+
+	Movement->SetComponentTickInterval(bReduced ? ReducedMovementTickInterval : Defaults->GetComponentTickInterval());
+	//walking still checks the floor when the capsule moved, just not every tick it stood still
+	Movement->bAlwaysCheckFloor = bReduced ? false : Defaults->bAlwaysCheckFloor;
+
+	//bots follow the navmesh projection instead of sweeping for the floor, proxies get their mode replicated
+	if (!Character->HasAuthority()) {
+		return;
+	}
+	if (bReduced && Movement->MovementMode == MOVE_Walking) {
+		Movement->SetMovementMode(MOVE_NavWalking);
+	}
+	else if (!bReduced && Movement->MovementMode == MOVE_NavWalking) {
+		Movement->SetMovementMode(MOVE_Walking);
+	}
+
+}
+
+UInstancedStaticMeshComponent* UShooterCrowdSubsystem::GetProxyComponent()
+{
+
+	if (ProxyComponent || !WITH_SHOOTER_COSMETICS || IsRunningDedicatedServer()) {
+		return ProxyComponent;
+	}
+
+	UStaticMesh* Mesh = ProxyMesh.Get();
+	if (Mesh == nullptr) {
+		return nullptr;
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.Name = TEXT("ShooterCrowdProxies");
+	SpawnParams.ObjectFlags = RF_Transient;
+	HostActor = GetWorld()->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParams);
+	HostActor->SetRootComponent(NewObject<USceneComponent>(HostActor, TEXT("Root")));
+	HostActor->GetRootComponent()->RegisterComponent();
+
+	//plain instanced, not hierarchical: every instance moves every frame and a cluster tree would be rebuilt each time
+	ProxyComponent = NewObject<UInstancedStaticMeshComponent>(HostActor);
+	ProxyComponent->SetStaticMesh(Mesh);
+	ProxyComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	ProxyComponent->SetMobility(EComponentMobility::Movable);
+	ProxyComponent->SetCastShadow(false);
+	ProxyComponent->SetupAttachment(HostActor->GetRootComponent());
+	ProxyComponent->RegisterComponent();
+	return ProxyComponent;
+
+}
+
+void UShooterCrowdSubsystem::UpdateProxyInstances()
+{
+
+	if (ProxyComponent == nullptr || InstanceOwners.Num() == 0) {
+		return;
+	}
+
+	TArray<FTransform> Transforms;
+	Transforms.SetNumUninitialized(InstanceOwners.Num());
+	for (int32 Instance = 0; Instance < InstanceOwners.Num(); Instance++) {
+
+		const int32 i = InstanceOwners[Instance];
+		Transforms[Instance] = FTransform(FRotator(0.f, AimRotations[i].Yaw, 0.f), Locations[i] - FVector(0.f, 0.f, HalfHeights[i]));
+
+	}
+	ProxyComponent->BatchUpdateInstancesTransforms(0, Transforms, true, true);
+
+}
+
+void UShooterCrowdSubsystem::RemoveProxyInstance(int32 Index)
+{
+
+	const int32 Instance = ProxyInstances[Index];
+	ProxyInstances[Index] = INDEX_NONE;
+	if (ProxyComponent == nullptr || !InstanceOwners.IsValidIndex(Instance)) {
+		return;
+	}
+
+	//a plain instanced component shifts everything after a removed instance down, so move the last
+	//instance into the hole and remove the last one; component order keeps matching InstanceOwners
+	const int32 LastInstance = InstanceOwners.Num() - 1;
+	if (Instance != LastInstance) {
+
+		FTransform LastTransform;
+		ProxyComponent->GetInstanceTransform(LastInstance, LastTransform, true);
+		ProxyComponent->UpdateInstanceTransform(Instance, LastTransform, true, false, true);
+
+	}
+	ProxyComponent->RemoveInstance(LastInstance);
+	InstanceOwners.RemoveAtSwap(Instance, 1, false);
+	if (InstanceOwners.IsValidIndex(Instance)) {
+		ProxyInstances[InstanceOwners[Instance]] = Instance;
+	}
+
+}
+
+void UShooterCrowdSubsystem::DumpToLog() const
+{
+
+	int32 NumDemoted = 0;
+	int32 NumDeadReckoned = 0;
+	int32 NumArmed = 0;
+	for (int32 i = 0; i < Characters.Num(); i++) {
+
+		NumDemoted += bDemoted[i];
+		NumDeadReckoned += bDeadReckoned[i];
+		NumArmed += Weapons[i].IsValid() ? 1 : 0;
+
+	}
+
+	UE_LOG(LogShooter, Log, TEXT("Crowd in %s: %d characters (%d armed), %d full actors (%d on reduced movement), %d demoted (%d dead reckoned), %d proxy instances, promote radius %.0f, movement LOD radius %.0f, last update %.3f ms"),
+		*GetWorld()->GetName(),
+		Characters.Num(),
+		NumArmed,
+		Characters.Num() - NumDemoted,
+		NumReducedMovement,
+		NumDemoted,
+		NumDeadReckoned,
+		InstanceOwners.Num(),
+		GShooterCrowdPromoteRadius,
+		GShooterCrowdMovementLODRadius,
+		LastUpdateMs);
+
+}
+
+static FAutoConsoleCommandWithWorldAndArgs CmdCrowd(
+	TEXT("Shooter.Crowd"),
+	TEXT("Logs full and demoted characters of the crowd subsystem and the cost of its last update."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World) {
+
+		if (UShooterCrowdSubsystem* Crowd = World ? World->GetSubsystem<UShooterCrowdSubsystem>() : nullptr) {
+			Crowd->DumpToLog();
+		}
+
+	}));
@@ -0,0 +1,103 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ShooterCrowdSubsystem.generated.h"
+
+/**
+ * Keeps distant characters out of the actor update. A bot (on the server) or a remote player's
+ * simulated proxy (on a client) farther than Shooter.Crowd.PromoteRadius from every player view is
+ * demoted: its actor, movement and mesh stop ticking and it is drawn as one instance of ProxyMesh.
+ * Location, velocity, aim and weapon of every registered character sit in parallel arrays that are
+ * updated with ParallelFor; demoted bots are dead reckoned there and written back to their actor a
+ * few times a second. Coming back inside the radius promotes the character to the full actor again.
+ * Full actors between Shooter.Crowd.MovementLODRadius and the promote radius that are not firing or
+ * aiming keep their actor but run reduced movement: a longer movement tick, no forced floor checks
+ * and, for server bots, MOVE_NavWalking on the navmesh instead of floor sweeps.
+ *
+ * The proxy mesh lives in DefaultGame.ini:
+ * [/Script/TheLastShooter.ShooterCrowdSubsystem]
+ * ProxyMesh=/Game/Crowd/SM_ShooterProxy.SM_ShooterProxy
+ */
+UCLASS(Config = Game)
+class THELASTSHOOTER_API UShooterCrowdSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	static UShooterCrowdSubsystem* Get(const UObject* WorldContextObject);
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	void Register(class AShooterChar* Character);
+	void Unregister(AShooterChar* Character);
+
+	void DumpToLog() const;
+
+	FORCEINLINE int32 GetNumReducedMovement() const { return NumReducedMovement; }
+
+	//every character counts as far from every view, for load tests whose local player would hold bots near
+	FORCEINLINE void SetIgnorePlayerViews(bool bIgnore) { bIgnorePlayerViews = bIgnore; }
+
+private:
+	void OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+
+	void Demote(int32 Index);
+	void Promote(int32 Index);
+	void UpdateProxyInstances();
+	void RemoveProxyInstance(int32 Index);
+
+	//dead reckoned motion since the last write-back clamped to the navmesh, the bot stops where a wall or
+	//the navmesh edge is in the way. Updates the arrays and returns where the actor goes
+	FVector SnapToNavigation(int32 Index);
+
+	//the character's actor, movement, mesh and weapon mesh on or off
+	static void SetFullUpdate(AShooterChar* Character, bool bFull);
+
+	//movement LOD of a full actor, back to the class defaults when bReduced is false
+	static void SetReducedMovement(AShooterChar* Character, bool bReduced);
+
+	class UInstancedStaticMeshComponent* GetProxyComponent();
+
+	UPROPERTY(Config)
+	TSoftObjectPtr<class UStaticMesh> ProxyMesh;
+
+	//one entry per registered character, same index in every array
+	TArray<TWeakObjectPtr<AShooterChar>> Characters;
+	TArray<FVector> Locations;
+	TArray<FVector> Velocities;
+	//last location a dead reckoned bot was written back to, on the navmesh
+	TArray<FVector> SettledLocations;
+	TArray<FRotator> AimRotations;
+	TArray<TWeakObjectPtr<class AWeapon>> Weapons;
+	TArray<float> DistSquared;
+	//capsule half height, the proxy stands on the ground below the actor location
+	TArray<float> HalfHeights;
+	TArray<uint8> bDemoted;
+	//true for server bots, their arrays are ahead of the actor; false for proxies that follow replication
+	TArray<uint8> bDeadReckoned;
+	//full actor on reduced movement, see SetReducedMovement
+	TArray<uint8> bReducedMovement;
+	//instance in the proxy component, INDEX_NONE while the actor draws itself
+	TArray<int32> ProxyInstances;
+
+	//character index per proxy instance, RemoveProxyInstance swaps the last instance into a hole so both keep one order
+	TArray<int32> InstanceOwners;
+
+	//spawned on first demotion, owns the proxy component
+	UPROPERTY(Transient)
+	AActor* HostActor;
+
+	UPROPERTY(Transient)
+	UInstancedStaticMeshComponent* ProxyComponent;
+
+	FDelegateHandle PostActorTickHandle;
+
+	uint64 UpdateFrame = 0;
+	float LastUpdateMs = 0.f;
+	int32 NumReducedMovement = 0;
+	bool bIgnorePlayerViews = false;
+};
@@ -0,0 +1,160 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterDamageQueue.h"
+#include "TheLastShooter.h"
+#include "ShooterPerf.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "GameFramework/Controller.h"
+#include "GameFramework/DamageType.h"
+#include "Kismet/GameplayStatics.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("ApplyQueuedDamage"), STAT_ApplyQueuedDamage, STATGROUP_TheLastShooter);
+
+static float GShooterHeadshotMultiplier = 2.f;
+static FAutoConsoleVariableRef CVarShooterHeadshotMultiplier(
+	TEXT("Shooter.Damage.HeadshotMultiplier"),
+	GShooterHeadshotMultiplier,
+	TEXT("Damage multiplier for hits on the head hitbox."));
+
+static float GShooterLimbMultiplier = 0.75f;
+static FAutoConsoleVariableRef CVarShooterLimbMultiplier(
+	TEXT("Shooter.Damage.LimbMultiplier"),
+	GShooterLimbMultiplier,
+	TEXT("Damage multiplier for hits on arm and leg hitboxes."));
+
+static float GShooterFalloffStart = 2000.f;
+static FAutoConsoleVariableRef CVarShooterFalloffStart(
+	TEXT("Shooter.Damage.FalloffStart"),
+	GShooterFalloffStart,
+	TEXT("Distance from the muzzle where damage starts to fall off."));
+
+static float GShooterFalloffEnd = 6000.f;
+static FAutoConsoleVariableRef CVarShooterFalloffEnd(
+	TEXT("Shooter.Damage.FalloffEnd"),
+	GShooterFalloffEnd,
+	TEXT("Distance from the muzzle where damage reaches Shooter.Damage.FalloffMinMultiplier."));
+
+static float GShooterFalloffMinMultiplier = 0.5f;
+static FAutoConsoleVariableRef CVarShooterFalloffMinMultiplier(
+	TEXT("Shooter.Damage.FalloffMinMultiplier"),
+	GShooterFalloffMinMultiplier,
+	TEXT("Damage multiplier at and beyond Shooter.Damage.FalloffEnd."));
+
+UShooterDamageQueue* UShooterDamageQueue::Get(const UObject* WorldContextObject)
+{
+
+	UWorld* World = GEngine ? GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::LogAndReturnNull) : nullptr;
+	return World ? World->GetSubsystem<UShooterDamageQueue>() : nullptr;
+
+}
+
+void UShooterDamageQueue::Initialize(FSubsystemCollectionBase& Collection)
+{
+
+	Super::Initialize(Collection);
+	PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &UShooterDamageQueue::OnWorldPostActorTick);
+
+}
+
+void UShooterDamageQueue::Deinitialize()
+{
+
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+	PendingHits.Reset();
+	Super::Deinitialize();
+
+}
+
+void UShooterDamageQueue::QueueHit(const FShooterHitRecord& Hit)
+{
+
+	PendingHits.Add(Hit);
+	FShooterFrameCounters::Get().AddDamageQueued();
+
+}
+
+float UShooterDamageQueue::GetBodyPartMultiplier(EShooterBodyPart BodyPart)
+{
+
+	switch (BodyPart) {
+	case EShooterBodyPart::ESBP_Head:
+		return GShooterHeadshotMultiplier;
+	case EShooterBodyPart::ESBP_LeftArm:
+	case EShooterBodyPart::ESBP_RightArm:
+	case EShooterBodyPart::ESBP_LeftLeg:
+	case EShooterBodyPart::ESBP_RightLeg:
+		return GShooterLimbMultiplier;
+	default:
+		break;
+	}
+	return 1.f;
+
+}
+
+float UShooterDamageQueue::GetFalloffMultiplier(float Distance)
+{
+
+	return FMath::GetMappedRangeValueClamped(FVector2D(GShooterFalloffStart, GShooterFalloffEnd),
+		FVector2D(1.f, GShooterFalloffMinMultiplier),
+		Distance);
+
+}
+
+void UShooterDamageQueue::OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+
+	if (World == GetWorld() && PendingHits.Num() > 0) {
+		ApplyQueuedDamage();
+	}
+
+}
+
+void UShooterDamageQueue::ApplyQueuedDamage()
+{
+	SCOPE_CYCLE_COUNTER(STAT_ApplyQueuedDamage);
+	FShooterFrameCounters::Get().NoteEvent(TEXT("ApplyQueuedDamage"));
+
+	struct FMergedDamage
+	{
+		float Damage = 0.f;
+		TWeakObjectPtr<AActor> DamageCauser;
+	};
+
+	TMap<TPair<TWeakObjectPtr<AActor>, TWeakObjectPtr<AController>>, FMergedDamage> MergedDamage;
+	MergedDamage.Reserve(PendingHits.Num());
+
+	for (const FShooterHitRecord& Hit : PendingHits) {
+
+		if (!Hit.Victim.IsValid()) {
+			continue;
+		}
+
+		FMergedDamage& Merged = MergedDamage.FindOrAdd(TPair<TWeakObjectPtr<AActor>, TWeakObjectPtr<AController>>(Hit.Victim, Hit.Instigator));
+		Merged.Damage += Hit.BaseDamage * GetBodyPartMultiplier(Hit.BodyPart) * GetFalloffMultiplier(Hit.Distance);
+		Merged.DamageCauser = Hit.DamageCauser;
+
+	}
+
+	//ApplyDamage can destroy actors and queue new hits, work on a detached list
+	PendingHits.Reset();
+
+	for (const auto& Pair : MergedDamage) {
+
+		AActor* Victim = Pair.Key.Key.Get();
+		if (Victim == nullptr || Pair.Value.Damage <= 0.f) {
+			continue;
+		}
+
+		UGameplayStatics::ApplyDamage(Victim,
+			Pair.Value.Damage,
+			Pair.Key.Value.Get(),
+			Pair.Value.DamageCauser.Get(),
+			UDamageType::StaticClass());
+		FShooterFrameCounters::Get().AddDamageApplied();
+
+	}
+
+}
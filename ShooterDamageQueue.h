@@ -0,0 +1,49 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ShooterHitboxes.h"
+#include "ShooterDamageQueue.generated.h"
+
+/** One bullet landing on something that can take damage */
+struct FShooterHitRecord
+{
+	TWeakObjectPtr<AActor> Victim;
+	TWeakObjectPtr<AController> Instigator;
+	TWeakObjectPtr<AActor> DamageCauser;
+	float BaseDamage = 0.f;
+	EShooterBodyPart BodyPart = EShooterBodyPart::ESBP_None;
+
+	//from the muzzle, drives damage falloff
+	float Distance = 0.f;
+};
+
+/**
+ * Collects hits during the frame and applies them after all actors ticked: body part and falloff
+ * multipliers in one pass, then a single ApplyDamage per victim and instigator.
+ */
+UCLASS()
+class THELASTSHOOTER_API UShooterDamageQueue : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	static UShooterDamageQueue* Get(const UObject* WorldContextObject);
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	void QueueHit(const FShooterHitRecord& Hit);
+
+	static float GetBodyPartMultiplier(EShooterBodyPart BodyPart);
+	static float GetFalloffMultiplier(float Distance);
+
+private:
+	void OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+	void ApplyQueuedDamage();
+
+	TArray<FShooterHitRecord> PendingHits;
+	FDelegateHandle PostActorTickHandle;
+};
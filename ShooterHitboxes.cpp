@@ -0,0 +1,401 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterHitboxes.h"
+#include "TheLastShooter.h"
+#include "ShooterChar.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Math/VectorRegister.h"
+
+DECLARE_CYCLE_STAT(TEXT("HitboxRayTest"), STAT_HitboxRayTest, STATGROUP_TheLastShooter);
+DECLARE_CYCLE_STAT(TEXT("HitboxRefresh"), STAT_HitboxRefresh, STATGROUP_TheLastShooter);
+
+void FShooterHitboxBatch::SetNum(int32 InNumCapsules)
+{
+
+	NumCapsules = InNumCapsules;
+	const int32 Padded = Align(NumCapsules, 4);
+
+	for (FAlignedFloats* Lane : { &AX, &AY, &AZ, &EX, &EY, &EZ, &EE }) {
+		Lane->SetNumZeroed(Padded);
+	}
+
+	RR.SetNumUninitialized(Padded);
+	for (float& RadiusSquared : RR) {
+		RadiusSquared = -1.f;
+	}
+
+}
+
+void FShooterHitboxBatch::Set(int32 Index, const FVector& Start, const FVector& End, float Radius)
+{
+
+	const FVector Segment{ End - Start };
+	AX[Index] = Start.X;
+	AY[Index] = Start.Y;
+	AZ[Index] = Start.Z;
+	EX[Index] = Segment.X;
+	EY[Index] = Segment.Y;
+	EZ[Index] = Segment.Z;
+	EE[Index] = Segment.SizeSquared();
+	RR[Index] = Radius > 0.f ? Radius * Radius : -1.f;
+
+}
+
+int32 FShooterHitboxBatch::RayTest(const FVector& Start,
+	const FVector& Direction,
+	float MaxDistance,
+	float& OutDistance,
+	int32 IgnoreBegin,
+	int32 IgnoreEnd) const
+{
+
+	// Closest points between the ray segment O + s*D, s in [0, MaxDistance] and each capsule
+	// segment A + t*E, t in [0, 1] (Ericson, Real-Time Collision Detection 5.1.9, with D.D = 1).
+	// A capsule is hit when they are closer than its radius; the entry distance is estimated as
+	// s - sqrt(r^2 - d^2), exact for rays perpendicular to the capsule.
+	const VectorRegister OX = VectorSetFloat1(Start.X);
+	const VectorRegister OY = VectorSetFloat1(Start.Y);
+	const VectorRegister OZ = VectorSetFloat1(Start.Z);
+	const VectorRegister DX = VectorSetFloat1(Direction.X);
+	const VectorRegister DY = VectorSetFloat1(Direction.Y);
+	const VectorRegister DZ = VectorSetFloat1(Direction.Z);
+	const VectorRegister Zero = VectorZero();
+	const VectorRegister One = VectorOne();
+	const VectorRegister MaxS = VectorSetFloat1(MaxDistance);
+	const VectorRegister Epsilon = VectorSetFloat1(KINDA_SMALL_NUMBER);
+
+	int32 BestIndex = INDEX_NONE;
+	float BestDistance = MaxDistance;
+
+	MS_ALIGN(16) float S[4] GCC_ALIGN(16);
+	MS_ALIGN(16) float DistSquared[4] GCC_ALIGN(16);
+
+	for (int32 i = 0; i < AX.Num(); i += 4) {
+
+		const VectorRegister EXv = VectorLoadAligned(&EX[i]);
+		const VectorRegister EYv = VectorLoadAligned(&EY[i]);
+		const VectorRegister EZv = VectorLoadAligned(&EZ[i]);
+		const VectorRegister E = VectorLoadAligned(&EE[i]);
+
+		// r = O - A
+		const VectorRegister RX = VectorSubtract(OX, VectorLoadAligned(&AX[i]));
+		const VectorRegister RY = VectorSubtract(OY, VectorLoadAligned(&AY[i]));
+		const VectorRegister RZ = VectorSubtract(OZ, VectorLoadAligned(&AZ[i]));
+
+		const VectorRegister F = VectorMultiplyAdd(EXv, RX, VectorMultiplyAdd(EYv, RY, VectorMultiply(EZv, RZ)));
+		const VectorRegister C = VectorMultiplyAdd(DX, RX, VectorMultiplyAdd(DY, RY, VectorMultiply(DZ, RZ)));
+		const VectorRegister B = VectorMultiplyAdd(DX, EXv, VectorMultiplyAdd(DY, EYv, VectorMultiply(DZ, EZv)));
+
+		// s on the infinite lines, 0 when they are parallel
+		const VectorRegister Denom = VectorSubtract(E, VectorMultiply(B, B));
+		const VectorRegister SNum = VectorSubtract(VectorMultiply(B, F), VectorMultiply(C, E));
+		VectorRegister SReg = VectorSelect(VectorCompareGT(Denom, Epsilon), VectorDivide(SNum, VectorMax(Denom, Epsilon)), Zero);
+		SReg = VectorMin(VectorMax(SReg, Zero), MaxS);
+
+		// matching t, redo s when t had to be clamped to the capsule ends
+		VectorRegister T = VectorDivide(VectorMultiplyAdd(B, SReg, F), VectorMax(E, Epsilon));
+		const VectorRegister BelowStart = VectorCompareGT(Zero, T);
+		const VectorRegister PastEnd = VectorCompareGT(T, One);
+		SReg = VectorSelect(BelowStart, VectorMin(VectorMax(VectorNegate(C), Zero), MaxS), SReg);
+		SReg = VectorSelect(PastEnd, VectorMin(VectorMax(VectorSubtract(B, C), Zero), MaxS), SReg);
+		T = VectorMin(VectorMax(T, Zero), One);
+
+		// a sphere has no segment to solve against: t = 0 and s is the ray's closest approach to A
+		const VectorRegister Degenerate = VectorCompareGT(Epsilon, E);
+		SReg = VectorSelect(Degenerate, VectorMin(VectorMax(VectorNegate(C), Zero), MaxS), SReg);
+		T = VectorSelect(Degenerate, Zero, T);
+
+		// P - Q = r + s*D - t*E
+		const VectorRegister PX = VectorSubtract(VectorMultiplyAdd(DX, SReg, RX), VectorMultiply(EXv, T));
+		const VectorRegister PY = VectorSubtract(VectorMultiplyAdd(DY, SReg, RY), VectorMultiply(EYv, T));
+		const VectorRegister PZ = VectorSubtract(VectorMultiplyAdd(DZ, SReg, RZ), VectorMultiply(EZv, T));
+		const VectorRegister Dist2 = VectorMultiplyAdd(PX, PX, VectorMultiplyAdd(PY, PY, VectorMultiply(PZ, PZ)));
+
+		const VectorRegister RadiusSquared = VectorLoadAligned(&RR[i]);
+		const int32 HitMask = VectorMaskBits(VectorCompareGE(RadiusSquared, Dist2));
+		if (HitMask == 0) {
+			continue;
+		}
+
+		VectorStoreAligned(SReg, S);
+		VectorStoreAligned(Dist2, DistSquared);
+		for (int32 Lane = 0; Lane < 4; Lane++) {
+
+			const int32 Index = i + Lane;
+			if ((HitMask & (1 << Lane)) == 0 || (Index >= IgnoreBegin && Index < IgnoreEnd)) {
+				continue;
+			}
+
+			const float EntryDistance = FMath::Max(0.f, S[Lane] - FMath::Sqrt(FMath::Max(0.f, RR[Index] - DistSquared[Lane])));
+			if (EntryDistance < BestDistance || BestIndex == INDEX_NONE) {
+				BestDistance = EntryDistance;
+				BestIndex = Index;
+			}
+
+		}
+
+	}
+
+	OutDistance = BestDistance;
+	return BestIndex;
+
+}
+
+UShooterHitboxSubsystem* UShooterHitboxSubsystem::Get(const UObject* WorldContextObject)
+{
+
+	UWorld* World = GEngine ? GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::LogAndReturnNull) : nullptr;
+	return World ? World->GetSubsystem<UShooterHitboxSubsystem>() : nullptr;
+
+}
+
+void UShooterHitboxSubsystem::Register(AShooterChar* Character, const TArray<FShooterHitboxDef>& Hitboxes)
+{
+
+	if (Character == nullptr || Character->GetMesh() == nullptr) {
+		return;
+	}
+
+	FCharacterHitboxes& Entry = Characters.AddDefaulted_GetRef();
+	Entry.Character = Character;
+	Entry.Hitboxes = Hitboxes;
+
+	//bone names are resolved once, refreshes go by index
+	USkeletalMeshComponent* Mesh = Character->GetMesh();
+	for (const FShooterHitboxDef& Hitbox : Hitboxes) {
+
+		Entry.StartBoneIndices.Add(Mesh->GetBoneIndex(Hitbox.StartBone));
+		Entry.EndBoneIndices.Add(Mesh->GetBoneIndex(Hitbox.EndBone));
+
+	}
+
+	bLayoutDirty = true;
+
+}
+
+void UShooterHitboxSubsystem::Unregister(AShooterChar* Character)
+{
+
+	const int32 Index = Characters.IndexOfByPredicate([Character](const FCharacterHitboxes& Entry) {
+		return Entry.Character.Get() == Character;
+	});
+
+	if (Index != INDEX_NONE) {
+		Characters.RemoveAtSwap(Index);
+		bLayoutDirty = true;
+	}
+
+}
+
+void UShooterHitboxSubsystem::RebuildLayout()
+{
+
+	Characters.RemoveAllSwap([](const FCharacterHitboxes& Entry) { return !Entry.Character.IsValid(); });
+
+	int32 NumCapsules = 0;
+	for (FCharacterHitboxes& Entry : Characters) {
+		Entry.FirstCapsule = NumCapsules;
+		NumCapsules += Entry.Hitboxes.Num();
+	}
+
+	Batch.SetNum(NumCapsules);
+	CapsuleOwners.SetNum(NumCapsules);
+	CapsuleBodyParts.SetNum(NumCapsules);
+
+	for (int32 CharacterIndex = 0; CharacterIndex < Characters.Num(); CharacterIndex++) {
+
+		const FCharacterHitboxes& Entry = Characters[CharacterIndex];
+		for (int32 i = 0; i < Entry.Hitboxes.Num(); i++) {
+			CapsuleOwners[Entry.FirstCapsule + i] = CharacterIndex;
+			CapsuleBodyParts[Entry.FirstCapsule + i] = Entry.Hitboxes[i].BodyPart;
+		}
+
+	}
+
+	bLayoutDirty = false;
+	RefreshedFrame = 0;
+
+}
+
+void UShooterHitboxSubsystem::RefreshIfStale()
+{
+
+	if (bLayoutDirty) {
+		RebuildLayout();
+	}
+
+	if (RefreshedFrame == GFrameCounter) {
+		return;
+	}
+	RefreshedFrame = GFrameCounter;
+
+	SCOPE_CYCLE_COUNTER(STAT_HitboxRefresh);
+	for (const FCharacterHitboxes& Entry : Characters) {
+
+		AShooterChar* Character = Entry.Character.Get();
+		USkeletalMeshComponent* Mesh = Character ? Character->GetMesh() : nullptr;
+
+		for (int32 i = 0; i < Entry.Hitboxes.Num(); i++) {
+
+			const int32 StartBone = Entry.StartBoneIndices[i];
+			const int32 EndBone = Entry.EndBoneIndices[i];
+			if (Mesh == nullptr || StartBone == INDEX_NONE || EndBone == INDEX_NONE) {
+				//missing bone, capsule never hits
+				Batch.Set(Entry.FirstCapsule + i, FVector::ZeroVector, FVector::ZeroVector, 0.f);
+				continue;
+			}
+
+			Batch.Set(Entry.FirstCapsule + i,
+				Mesh->GetBoneTransform(StartBone).GetLocation(),
+				Mesh->GetBoneTransform(EndBone).GetLocation(),
+				Entry.Hitboxes[i].Radius);
+
+		}
+
+	}
+
+}
+
+bool UShooterHitboxSubsystem::RayTest(const FVector& Start,
+	const FVector& Direction,
+	float MaxDistance,
+	const AActor* IgnoredActor,
+	FShooterHitboxHit& OutHit)
+{
+	SCOPE_CYCLE_COUNTER(STAT_HitboxRayTest);
+
+	RefreshIfStale();
+
+	int32 IgnoreBegin = 0;
+	int32 IgnoreEnd = 0;
+	for (const FCharacterHitboxes& Entry : Characters) {
+
+		if (IgnoredActor && Entry.Character.Get() == IgnoredActor) {
+			IgnoreBegin = Entry.FirstCapsule;
+			IgnoreEnd = Entry.FirstCapsule + Entry.Hitboxes.Num();
+			break;
+		}
+
+	}
+
+	float Distance = 0.f;
+	const int32 Capsule = Batch.RayTest(Start, Direction, MaxDistance, Distance, IgnoreBegin, IgnoreEnd);
+	if (Capsule == INDEX_NONE) {
+		return false;
+	}
+
+	OutHit.Character = Characters[CapsuleOwners[Capsule]].Character.Get();
+	OutHit.BodyPart = CapsuleBodyParts[Capsule];
+	OutHit.Distance = Distance;
+	OutHit.Location = Start + Direction * Distance;
+	return OutHit.Character != nullptr;
+
+}
+
+static FAutoConsoleCommand CmdBenchHitboxes(
+	TEXT("Shooter.BenchHitboxes"),
+	TEXT("Shooter.BenchHitboxes [Characters=128] [Rays=100000]: checks known hits on one character, then rays per second against synthetic six-capsule characters."),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args) {
+
+		const int32 NumCharacters = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 128;
+		const int32 NumRays = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 100000;
+		const int32 CapsulesPerCharacter = 6;
+
+		//the head is a sphere like the default head hitbox (same start and end bone)
+		auto SetCharacter = [](FShooterHitboxBatch& Batch, int32 First, const FVector& Feet) {
+
+			Batch.Set(First + 0, Feet + FVector(0.f, 0.f, 165.f), Feet + FVector(0.f, 0.f, 165.f), 15.f);
+			Batch.Set(First + 1, Feet + FVector(0.f, 0.f, 95.f), Feet + FVector(0.f, 0.f, 145.f), 22.f);
+			Batch.Set(First + 2, Feet + FVector(0.f, -20.f, 140.f), Feet + FVector(0.f, -60.f, 100.f), 8.f);
+			Batch.Set(First + 3, Feet + FVector(0.f, 20.f, 140.f), Feet + FVector(0.f, 60.f, 100.f), 8.f);
+			Batch.Set(First + 4, Feet + FVector(0.f, -12.f, 90.f), Feet + FVector(0.f, -12.f, 5.f), 11.f);
+			Batch.Set(First + 5, Feet + FVector(0.f, 12.f, 90.f), Feet + FVector(0.f, 12.f, 5.f), 11.f);
+
+		};
+
+		//known answers on one character at the origin, shot from 1000 units down -X
+		FShooterHitboxBatch CheckBatch;
+		CheckBatch.SetNum(CapsulesPerCharacter);
+		SetCharacter(CheckBatch, 0, FVector::ZeroVector);
+		struct FHitboxCheck
+		{
+			const TCHAR* Name;
+			FVector Start;
+			int32 ExpectedIndex;
+			float ExpectedDistance;
+		};
+		const FHitboxCheck Checks[] = {
+			{ TEXT("head sphere"), FVector(-1000.f, 0.f, 165.f), 0, 985.f },
+			{ TEXT("head sphere off centre"), FVector(-1000.f, 9.f, 165.f), 0, 988.f },
+			{ TEXT("torso"), FVector(-1000.f, 0.f, 120.f), 1, 978.f },
+			{ TEXT("miss beside the head"), FVector(-1000.f, 20.f, 170.f), INDEX_NONE, 0.f },
+		};
+		int32 NumFailed = 0;
+		for (const FHitboxCheck& Check : Checks) {
+
+			float Distance = 0.f;
+			const int32 Index = CheckBatch.RayTest(Check.Start, FVector(1.f, 0.f, 0.f), 50'000.f, Distance);
+			const bool bPass = Index == Check.ExpectedIndex && (Index == INDEX_NONE || FMath::IsNearlyEqual(Distance, Check.ExpectedDistance, 0.5f));
+			if (!bPass) {
+				NumFailed++;
+			}
+			UE_LOG(LogShooter, Display, TEXT("Hitbox check %s: %s (capsule %d at %.1f, expected %d at %.1f)"),
+				Check.Name,
+				bPass ? TEXT("PASS") : TEXT("FAIL"),
+				Index,
+				Distance,
+				Check.ExpectedIndex,
+				Check.ExpectedDistance);
+
+		}
+		if (NumFailed > 0) {
+			UE_LOG(LogShooter, Error, TEXT("Hitbox bench: %d checks failed"), NumFailed);
+		}
+
+		//characters standing on a 4000 x 4000 floor, rays from random points around them
+		FRandomStream Stream(1234);
+		FShooterHitboxBatch Batch;
+		Batch.SetNum(NumCharacters * CapsulesPerCharacter);
+		for (int32 i = 0; i < NumCharacters; i++) {
+
+			const FVector Feet{ Stream.FRandRange(-2000.f, 2000.f), Stream.FRandRange(-2000.f, 2000.f), 0.f };
+			SetCharacter(Batch, i * CapsulesPerCharacter, Feet);
+
+		}
+
+		TArray<FVector> RayStarts;
+		TArray<FVector> RayDirections;
+		RayStarts.SetNumUninitialized(NumRays);
+		RayDirections.SetNumUninitialized(NumRays);
+		for (int32 i = 0; i < NumRays; i++) {
+
+			RayStarts[i] = FVector(Stream.FRandRange(-2500.f, 2500.f), Stream.FRandRange(-2500.f, 2500.f), Stream.FRandRange(50.f, 200.f));
+			RayDirections[i] = FVector(Stream.FRandRange(-1.f, 1.f), Stream.FRandRange(-1.f, 1.f), Stream.FRandRange(-0.1f, 0.1f)).GetSafeNormal();
+
+		}
+
+		int32 Hits = 0;
+		const double StartSeconds = FPlatformTime::Seconds();
+		for (int32 i = 0; i < NumRays; i++) {
+
+			float Distance;
+			if (Batch.RayTest(RayStarts[i], RayDirections[i], 50'000.f, Distance) != INDEX_NONE) {
+				Hits++;
+			}
+
+		}
+		const double Seconds = FPlatformTime::Seconds() - StartSeconds;
+
+		UE_LOG(LogShooter, Display, TEXT("Hitbox bench: %d characters (%d capsules), %d rays in %.3f ms, %.0f rays/s, %d hits"),
+			NumCharacters,
+			Batch.Num(),
+			NumRays,
+			Seconds * 1000.0,
+			NumRays / FMath::Max(Seconds, 1e-9),
+			Hits);
+
+	}));
@@ -0,0 +1,139 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ShooterHitboxes.generated.h"
+
+UENUM(BlueprintType)
+enum class EShooterBodyPart : uint8 {
+	ESBP_None UMETA(DisplayName = "None"),
+	ESBP_Head UMETA(DisplayName = "Head"),
+	ESBP_Torso UMETA(DisplayName = "Torso"),
+	ESBP_LeftArm UMETA(DisplayName = "LeftArm"),
+	ESBP_RightArm UMETA(DisplayName = "RightArm"),
+	ESBP_LeftLeg UMETA(DisplayName = "LeftLeg"),
+	ESBP_RightLeg UMETA(DisplayName = "RightLeg"),
+
+	ESBP_Max UMETA(DisplayName = "Max")
+};
+
+/** One gameplay hit capsule, spanning two bones of the character mesh */
+USTRUCT(BlueprintType)
+struct FShooterHitboxDef
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Hitbox)
+	EShooterBodyPart BodyPart = EShooterBodyPart::ESBP_None;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Hitbox)
+	FName StartBone;
+
+	//same as StartBone for a sphere
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Hitbox)
+	FName EndBone;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Hitbox)
+	float Radius = 10.f;
+
+	FShooterHitboxDef() {}
+
+	FShooterHitboxDef(EShooterBodyPart InBodyPart, FName InStartBone, FName InEndBone, float InRadius) :
+		BodyPart(InBodyPart),
+		StartBone(InStartBone),
+		EndBone(InEndBone),
+		Radius(InRadius)
+	{}
+};
+
+struct FShooterHitboxHit
+{
+	class AShooterChar* Character = nullptr;
+	EShooterBodyPart BodyPart = EShooterBodyPart::ESBP_None;
+	float Distance = 0.f;
+	FVector Location = FVector::ZeroVector;
+};
+
+/**
+ * Capsules in structure-of-arrays layout, tested against a ray four at a time with VectorRegister math.
+ * Padding lanes have a negative squared radius so they never hit.
+ */
+class THELASTSHOOTER_API FShooterHitboxBatch
+{
+public:
+	void SetNum(int32 NumCapsules);
+	FORCEINLINE int32 Num() const { return NumCapsules; }
+
+	void Set(int32 Index, const FVector& Start, const FVector& End, float Radius);
+
+	//nearest capsule whose surface the ray enters within MaxDistance, INDEX_NONE on a miss.
+	//capsules in [IgnoreBegin, IgnoreEnd) are skipped. Direction must be normalized.
+	int32 RayTest(const FVector& Start,
+		const FVector& Direction,
+		float MaxDistance,
+		float& OutDistance,
+		int32 IgnoreBegin = 0,
+		int32 IgnoreEnd = 0) const;
+
+private:
+	typedef TArray<float, TAlignedHeapAllocator<16>> FAlignedFloats;
+
+	//segment start, segment vector (end - start), its squared length and the squared radius
+	FAlignedFloats AX, AY, AZ;
+	FAlignedFloats EX, EY, EZ;
+	FAlignedFloats EE;
+	FAlignedFloats RR;
+
+	int32 NumCapsules = 0;
+};
+
+/**
+ * Owns the hitboxes of every AShooterChar in the world. Capsules are refreshed from the bones
+ * at most once per frame, the first time somebody shoots.
+ */
+UCLASS()
+class THELASTSHOOTER_API UShooterHitboxSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	static UShooterHitboxSubsystem* Get(const UObject* WorldContextObject);
+
+	void Register(AShooterChar* Character, const TArray<FShooterHitboxDef>& Hitboxes);
+	void Unregister(AShooterChar* Character);
+
+	//Direction must be normalized
+	bool RayTest(const FVector& Start,
+		const FVector& Direction,
+		float MaxDistance,
+		const AActor* IgnoredActor,
+		FShooterHitboxHit& OutHit);
+
+	FORCEINLINE int32 GetNumCharacters() const { return Characters.Num(); }
+
+private:
+	struct FCharacterHitboxes
+	{
+		TWeakObjectPtr<AShooterChar> Character;
+		TArray<FShooterHitboxDef> Hitboxes;
+		TArray<int32> StartBoneIndices;
+		TArray<int32> EndBoneIndices;
+		int32 FirstCapsule = 0;
+	};
+
+	void RebuildLayout();
+	void RefreshIfStale();
+
+	TArray<FCharacterHitboxes> Characters;
+
+	FShooterHitboxBatch Batch;
+
+	//index into Characters and the body part, per capsule
+	TArray<int32> CapsuleOwners;
+	TArray<EShooterBodyPart> CapsuleBodyParts;
+
+	uint64 RefreshedFrame = 0;
+	bool bLayoutDirty = false;
+};
@@ -0,0 +1,242 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterInputRecorder.h"
+#include "TheLastShooter.h"
+#include "ShooterPerf.h"
+#include "RenderCore.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+static const uint32 InputFileMagic = 0x31524953; // 'SIR1'
+static const uint32 InputFileVersion = 1;
+
+//bytes of the header and of one serialized frame: delta seconds, the axes and the held action bits
+static const int64 InputFileHeaderBytes = 3 * sizeof(uint32);
+static const int64 InputFrameBytes = sizeof(float) + (int32)EShooterInputAxis::ESIA_Max * sizeof(float) + sizeof(uint8);
+
+FShooterInputRecorder::FShooterInputRecorder() :
+	ReplayIndex(0),
+	bRecording(false),
+	bReplaying(false)
+{
+}
+
+void FShooterInputRecorder::InitFromCommandLine()
+{
+
+	if (bRecording || bReplaying) {
+		return;
+	}
+
+	const TCHAR* CommandLine = FCommandLine::Get();
+	if (FParse::Value(CommandLine, TEXT("ShooterReplayInput="), FilePath)) {
+
+		bReplaying = LoadRecording();
+		if (bReplaying) {
+
+			//fixed step so every replay advances the simulation identically
+			float ReplayFPS = 60.f;
+			FParse::Value(CommandLine, TEXT("ShooterReplayFPS="), ReplayFPS);
+			FApp::SetUseFixedTimeStep(true);
+			FApp::SetFixedDeltaTime(1.0 / FMath::Max(ReplayFPS, 1.f));
+			ReplayGameThreadMs.Reserve(Frames.Num());
+
+			UE_LOG(LogShooter, Log, TEXT("Replaying %d input frames from %s at %.0f fps"), Frames.Num(), *FilePath, ReplayFPS);
+
+		}
+
+	}
+	else if (FParse::Value(CommandLine, TEXT("ShooterRecordInput="), FilePath)) {
+
+		bRecording = true;
+		UE_LOG(LogShooter, Log, TEXT("Recording input to %s"), *FilePath);
+
+	}
+
+}
+
+void FShooterInputRecorder::SetAxis(EShooterInputAxis Axis, float Value)
+{
+
+	if (bRecording) {
+		CurrentFrame.Axes[(int32)Axis] = Value;
+	}
+
+}
+
+void FShooterInputRecorder::SetAction(EShooterInputAction Action, bool bHeld)
+{
+
+	if (bRecording) {
+
+		if (bHeld) {
+			CurrentFrame.HeldActions |= (1 << (int32)Action);
+		}
+		else {
+			CurrentFrame.HeldActions &= ~(1 << (int32)Action);
+		}
+
+	}
+
+}
+
+bool FShooterInputRecorder::NextReplayFrame(FShooterInputFrame& OutFrame)
+{
+
+	if (!bReplaying || ReplayIndex >= Frames.Num()) {
+		return false;
+	}
+
+	OutFrame = Frames[ReplayIndex++];
+	return true;
+
+}
+
+void FShooterInputRecorder::EndFrame(float DeltaSeconds)
+{
+
+	if (bRecording) {
+
+		CurrentFrame.DeltaSeconds = DeltaSeconds;
+		Frames.Add(CurrentFrame);
+
+	}
+	else if (bReplaying) {
+
+		//GGameThreadTime is the previous frame's, the first sample belongs to the frame before the replay
+		if (ReplayIndex > 1) {
+			ReplayGameThreadMs.Add(FPlatformTime::ToMilliseconds(GGameThreadTime));
+		}
+
+		if (ReplayIndex >= Frames.Num()) {
+			Finish();
+			FPlatformMisc::RequestExit(false);
+		}
+
+	}
+
+}
+
+void FShooterInputRecorder::Finish()
+{
+
+	if (bRecording) {
+
+		bRecording = false;
+		if (SaveRecording()) {
+			UE_LOG(LogShooter, Log, TEXT("Recorded %d input frames to %s"), Frames.Num(), *FilePath);
+		}
+
+	}
+	else if (bReplaying) {
+
+		bReplaying = false;
+		WriteReplayReport();
+
+	}
+
+}
+
+bool FShooterInputRecorder::SaveRecording() const
+{
+
+	TArray<uint8> Bytes;
+	Bytes.Reserve(12 + Frames.Num() * 29);
+	FMemoryWriter Writer(Bytes);
+
+	uint32 Magic = InputFileMagic;
+	uint32 Version = InputFileVersion;
+	uint32 NumFrames = Frames.Num();
+	Writer << Magic << Version << NumFrames;
+
+	for (FShooterInputFrame Frame : Frames) {
+
+		Writer << Frame.DeltaSeconds;
+		for (float& Axis : Frame.Axes) {
+			Writer << Axis;
+		}
+		Writer << Frame.HeldActions;
+
+	}
+
+	if (!FFileHelper::SaveArrayToFile(Bytes, *FilePath)) {
+		UE_LOG(LogShooter, Error, TEXT("Can't write input recording %s"), *FilePath);
+		return false;
+	}
+	return true;
+
+}
+
+bool FShooterInputRecorder::LoadRecording()
+{
+
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *FilePath)) {
+		UE_LOG(LogShooter, Error, TEXT("Can't read input recording %s"), *FilePath);
+		return false;
+	}
+
+	FMemoryReader Reader(Bytes);
+	uint32 Magic = 0;
+	uint32 Version = 0;
+	uint32 NumFrames = 0;
+	Reader << Magic << Version << NumFrames;
+
+	if (Magic != InputFileMagic || Version != InputFileVersion) {
+		UE_LOG(LogShooter, Error, TEXT("%s is not an input recording this build can read"), *FilePath);
+		return false;
+	}
+
+	//the header count is checked against the file size before it sizes anything
+	if (Reader.IsError() || NumFrames > (Bytes.Num() - InputFileHeaderBytes) / InputFrameBytes) {
+		UE_LOG(LogShooter, Error, TEXT("Input recording %s claims %u frames, more than the file holds"), *FilePath, NumFrames);
+		return false;
+	}
+
+	Frames.SetNum(NumFrames);
+	for (FShooterInputFrame& Frame : Frames) {
+
+		Reader << Frame.DeltaSeconds;
+		for (float& Axis : Frame.Axes) {
+			Reader << Axis;
+		}
+		Reader << Frame.HeldActions;
+
+	}
+
+	if (Reader.IsError()) {
+		UE_LOG(LogShooter, Error, TEXT("Input recording %s is truncated"), *FilePath);
+		Frames.Reset();
+		return false;
+	}
+	return true;
+
+}
+
+void FShooterInputRecorder::WriteReplayReport()
+{
+
+	FString Csv = TEXT("Frame,GameThreadMs\n");
+	for (int32 i = 0; i < ReplayGameThreadMs.Num(); i++) {
+		Csv += FString::Printf(TEXT("%d,%.3f\n"), i, ReplayGameThreadMs[i]);
+	}
+
+	const FString ReportName = FPaths::MakeValidFileName(FString::Printf(TEXT("ShooterReplay-%s-%s.csv"),
+		*FPaths::GetBaseFilename(FilePath),
+		FApp::GetBuildVersion()));
+	const FString ReportPath = FPaths::ProfilingDir() / ReportName;
+	FFileHelper::SaveStringToFile(Csv, *ReportPath);
+
+	TArray<float> Samples = ReplayGameThreadMs;
+	UE_LOG(LogShooter, Display, TEXT("Input replay %s on %s: game thread %s, report %s"),
+		*FilePath,
+		FApp::GetBuildVersion(),
+		*FShooterPercentiles::Compute(Samples).ToString(),
+		*ReportPath);
+
+}
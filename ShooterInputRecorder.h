@@ -0,0 +1,86 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+enum class EShooterInputAxis : uint8 {
+	ESIA_MoveForward,
+	ESIA_MoveRight,
+	ESIA_Turn,
+	ESIA_LookUp,
+	ESIA_TurnRate,
+	ESIA_LookUpRate,
+
+	ESIA_Max
+};
+
+enum class EShooterInputAction : uint8 {
+	ESIAc_Jump,
+	ESIAc_FireButton,
+	ESIAc_AimingButton,
+	ESIAc_Select,
+
+	ESIAc_Max
+};
+
+/** Everything bound in AShooterChar::SetupPlayerInputComponent for one frame */
+struct FShooterInputFrame
+{
+	float DeltaSeconds = 0.f;
+	float Axes[(int32)EShooterInputAxis::ESIA_Max] = {};
+
+	//bit per EShooterInputAction, set while the action is held
+	uint8 HeldActions = 0;
+
+	FORCEINLINE bool IsHeld(EShooterInputAction Action) const { return (HeldActions & (1 << (int32)Action)) != 0; }
+};
+
+/**
+ * Records a local player's bound inputs to a compact binary file and plays them back headless.
+ *
+ *   -ShooterRecordInput=<file>    record until the character ends play
+ *   -ShooterReplayInput=<file>    replay at a fixed step (-ShooterReplayFPS=, default 60), then write
+ *                                 Saved/Profiling/ShooterReplay-<file>-<build>.csv and quit
+ *
+ * File: uint32 magic 'SIR1', uint32 version, uint32 frame count, then per frame
+ * float DeltaSeconds, float Axes[ESIA_Max], uint8 HeldActions (29 bytes).
+ */
+class THELASTSHOOTER_API FShooterInputRecorder
+{
+public:
+	FShooterInputRecorder();
+
+	void InitFromCommandLine();
+
+	FORCEINLINE bool IsRecording() const { return bRecording; }
+	FORCEINLINE bool IsReplaying() const { return bReplaying; }
+
+	//recording only, ignored otherwise
+	void SetAxis(EShooterInputAxis Axis, float Value);
+	void SetAction(EShooterInputAction Action, bool bHeld);
+
+	//next recorded frame, false once the replay ran out
+	bool NextReplayFrame(FShooterInputFrame& OutFrame);
+
+	//recording: stores the frame, replaying: samples the game thread time
+	void EndFrame(float DeltaSeconds);
+
+	//writes the recording or the replay report
+	void Finish();
+
+private:
+	bool SaveRecording() const;
+	bool LoadRecording();
+	void WriteReplayReport();
+
+	FString FilePath;
+	TArray<FShooterInputFrame> Frames;
+	FShooterInputFrame CurrentFrame;
+
+	int32 ReplayIndex;
+	TArray<float> ReplayGameThreadMs;
+
+	bool bRecording;
+	bool bReplaying;
+};
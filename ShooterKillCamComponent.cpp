@@ -0,0 +1,327 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterKillCamComponent.h"
+#include "TheLastShooter.h"
+#include "ShooterChar.h"
+#include "Camera/CameraActor.h"
+#include "GameFramework/PlayerController.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+UShooterKillCamComponent::UShooterKillCamComponent() :
+	RecordSeconds(10.f),
+	RecordHz(30.f),
+	MaxBytes(8 * 1024),
+	NextFrame(0),
+	NumRecorded(0),
+	LastRecordSeconds(0.f),
+	bFiredSinceLastFrame(false),
+	PlaybackCamera(nullptr),
+	PlaybackViewer(nullptr),
+	PlaybackSeconds(0.f),
+	PlaybackIndex(0),
+	PlaybackEyeHeight(0.f)
+{
+
+	PrimaryComponentTick.bCanEverTick = true;
+	//after movement, so frames hold where the character ended up
+	PrimaryComponentTick.TickGroup = TG_PostPhysics;
+
+}
+
+void UShooterKillCamComponent::BeginPlay()
+{
+
+	Super::BeginPlay();
+
+	if (IsRunningDedicatedServer()) {
+		SetComponentTickEnabled(false);
+		return;
+	}
+
+	const int32 WantedFrames = FMath::CeilToInt(RecordSeconds * RecordHz);
+	const int32 BudgetFrames = MaxBytes / (int32)sizeof(FKillCamFrame);
+	UE_CLOG(WantedFrames > BudgetFrames, LogShooter, Warning, TEXT("%s: kill-cam needs %d frames for %.1f s at %.0f Hz, %d bytes allow %d"),
+		*GetOwner()->GetName(),
+		WantedFrames,
+		RecordSeconds,
+		RecordHz,
+		MaxBytes,
+		BudgetFrames);
+
+	Frames.SetNumZeroed(FMath::Max(FMath::Min(WantedFrames, BudgetFrames), 2));
+	SetComponentTickInterval(1.f / RecordHz);
+
+}
+
+void UShooterKillCamComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+
+	StopPlayback();
+	Super::EndPlay(EndPlayReason);
+
+}
+
+void UShooterKillCamComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	if (IsPlayingBack()) {
+		TickPlayback(DeltaTime);
+	}
+	else if (Frames.Num() > 0) {
+		Record();
+	}
+
+}
+
+void UShooterKillCamComponent::Record()
+{
+
+	const AActor* Owner = GetOwner();
+	const APawn* Pawn = Cast<APawn>(Owner);
+	const AShooterChar* Character = Cast<AShooterChar>(Owner);
+	const float NowSeconds = GetWorld()->GetTimeSeconds();
+
+	uint8 Flags = 0;
+	if (Character && Character->GetAiming()) {
+		Flags |= FKillCamFrame::Aiming;
+	}
+	if (bFiredSinceLastFrame) {
+		Flags |= FKillCamFrame::Fired;
+	}
+
+	Encode(Frames[NextFrame],
+		NumRecorded > 0 ? NowSeconds - LastRecordSeconds : 0.f,
+		Owner->GetActorLocation(),
+		Owner->GetActorRotation().Yaw,
+		Pawn ? Pawn->GetBaseAimRotation() : Owner->GetActorRotation(),
+		Flags);
+
+	NextFrame = (NextFrame + 1) % Frames.Num();
+	NumRecorded = FMath::Min(NumRecorded + 1, Frames.Num());
+	LastRecordSeconds = NowSeconds;
+	bFiredSinceLastFrame = false;
+
+}
+
+void UShooterKillCamComponent::Encode(FKillCamFrame& OutFrame, float DeltaSeconds, const FVector& Location, float ActorYaw, const FRotator& AimRotation, uint8 Flags)
+{
+
+	OutFrame.DeltaMs = (uint16)FMath::Clamp(FMath::RoundToInt(DeltaSeconds * 1000.f), 0, (int32)MAX_uint16);
+	OutFrame.ActorYaw = FRotator::CompressAxisToShort(ActorYaw);
+	OutFrame.AimYaw = FRotator::CompressAxisToShort(AimRotation.Yaw);
+	OutFrame.AimPitch = FRotator::CompressAxisToShort(AimRotation.Pitch);
+
+	for (int32 Axis = 0; Axis < 3; Axis++) {
+
+		const int32 Centimeters = FMath::Clamp(FMath::RoundToInt(Location[Axis]), -(1 << 23), (1 << 23) - 1);
+		const uint32 Bits = (uint32)Centimeters;
+		OutFrame.Location[Axis * 3 + 0] = (uint8)Bits;
+		OutFrame.Location[Axis * 3 + 1] = (uint8)(Bits >> 8);
+		OutFrame.Location[Axis * 3 + 2] = (uint8)(Bits >> 16);
+
+	}
+
+	OutFrame.Flags = Flags;
+
+}
+
+void UShooterKillCamComponent::Decode(const FKillCamFrame& Frame, FKillCamDecodedFrame& OutFrame)
+{
+
+	for (int32 Axis = 0; Axis < 3; Axis++) {
+
+		const uint32 Bits = Frame.Location[Axis * 3 + 0] |
+			(Frame.Location[Axis * 3 + 1] << 8) |
+			(Frame.Location[Axis * 3 + 2] << 16);
+		//sign extend the 24 bits
+		OutFrame.Location[Axis] = (float)((int32)(Bits << 8) >> 8);
+
+	}
+
+	OutFrame.ActorYaw = FRotator::DecompressAxisFromShort(Frame.ActorYaw);
+	OutFrame.AimRotation = FRotator(FRotator::DecompressAxisFromShort(Frame.AimPitch), FRotator::DecompressAxisFromShort(Frame.AimYaw), 0.f).GetNormalized();
+	OutFrame.bAiming = (Frame.Flags & FKillCamFrame::Aiming) != 0;
+	OutFrame.bFired = (Frame.Flags & FKillCamFrame::Fired) != 0;
+
+}
+
+void UShooterKillCamComponent::Decode(TArray<FKillCamDecodedFrame>& OutFrames) const
+{
+
+	OutFrames.SetNum(NumRecorded);
+	const int32 Oldest = NumRecorded < Frames.Num() ? 0 : NextFrame;
+	float Seconds = 0.f;
+	for (int32 i = 0; i < NumRecorded; i++) {
+
+		const FKillCamFrame& Frame = Frames[(Oldest + i) % Frames.Num()];
+		if (i > 0) {
+			Seconds += Frame.DeltaMs / 1000.f;
+		}
+		Decode(Frame, OutFrames[i]);
+		OutFrames[i].Seconds = Seconds;
+
+	}
+
+}
+
+void UShooterKillCamComponent::StartPlayback(APlayerController* Viewer)
+{
+
+	if (Viewer == nullptr || IsPlayingBack()) {
+		return;
+	}
+
+	Decode(PlaybackFrames);
+	if (PlaybackFrames.Num() < 2) {
+		OnPlaybackFinished.Broadcast();
+		return;
+	}
+
+	const ACharacter* Character = Cast<ACharacter>(GetOwner());
+	PlaybackEyeHeight = Character ? Character->BaseEyeHeight : 0.f;
+	PlaybackSeconds = 0.f;
+	PlaybackIndex = 0;
+	PlaybackViewer = Viewer;
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.ObjectFlags |= RF_Transient;
+	const FKillCamDecodedFrame& First = PlaybackFrames[0];
+	PlaybackCamera = GetWorld()->SpawnActor<ACameraActor>(ACameraActor::StaticClass(),
+		First.Location + FVector(0.f, 0.f, PlaybackEyeHeight),
+		First.AimRotation,
+		SpawnParams);
+	Viewer->SetViewTarget(PlaybackCamera);
+
+	//playback moves the camera every frame, recording resumes at RecordHz afterwards
+	SetComponentTickInterval(0.f);
+	SetComponentTickEnabled(true);
+
+}
+
+void UShooterKillCamComponent::TickPlayback(float DeltaTime)
+{
+
+	PlaybackSeconds += DeltaTime;
+	while (PlaybackIndex + 1 < PlaybackFrames.Num() && PlaybackFrames[PlaybackIndex + 1].Seconds <= PlaybackSeconds) {
+
+		PlaybackIndex++;
+		const FKillCamDecodedFrame& Frame = PlaybackFrames[PlaybackIndex];
+		if (Frame.bFired) {
+			OnPlaybackShot.Broadcast(Frame.Location + FVector(0.f, 0.f, PlaybackEyeHeight), Frame.AimRotation);
+		}
+
+	}
+
+	if (PlaybackIndex + 1 >= PlaybackFrames.Num()) {
+		StopPlayback();
+		return;
+	}
+
+	const FKillCamDecodedFrame& From = PlaybackFrames[PlaybackIndex];
+	const FKillCamDecodedFrame& To = PlaybackFrames[PlaybackIndex + 1];
+	const float Alpha = (PlaybackSeconds - From.Seconds) / FMath::Max(To.Seconds - From.Seconds, KINDA_SMALL_NUMBER);
+
+	PlaybackCamera->SetActorLocationAndRotation(FMath::Lerp(From.Location, To.Location, Alpha) + FVector(0.f, 0.f, PlaybackEyeHeight),
+		FQuat::Slerp(From.AimRotation.Quaternion(), To.AimRotation.Quaternion(), Alpha));
+
+}
+
+void UShooterKillCamComponent::StopPlayback()
+{
+
+	if (!IsPlayingBack()) {
+		return;
+	}
+
+	if (PlaybackViewer) {
+		PlaybackViewer->SetViewTarget(PlaybackViewer->GetPawn() ? (AActor*)PlaybackViewer->GetPawn() : PlaybackViewer);
+	}
+	if (IsValid(PlaybackCamera)) {
+		PlaybackCamera->Destroy();
+	}
+	PlaybackCamera = nullptr;
+	PlaybackViewer = nullptr;
+	PlaybackFrames.Empty();
+
+	//the playback is not a gap in the recording, the next frame comes one interval after the last
+	SetComponentTickInterval(1.f / RecordHz);
+	LastRecordSeconds = GetWorld()->GetTimeSeconds() - 1.f / RecordHz;
+	OnPlaybackFinished.Broadcast();
+
+}
+
+static FAutoConsoleCommandWithWorldAndArgs CmdKillCam(
+	TEXT("Shooter.KillCam"),
+	TEXT("Plays the local player's own kill-cam recording back to them."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World) {
+
+		APlayerController* PlayerController = World ? World->GetFirstPlayerController() : nullptr;
+		APawn* Pawn = PlayerController ? PlayerController->GetPawn() : nullptr;
+		UShooterKillCamComponent* KillCam = Pawn ? Pawn->FindComponentByClass<UShooterKillCamComponent>() : nullptr;
+		if (KillCam) {
+			KillCam->StartPlayback(PlayerController);
+		}
+
+	}));
+
+static FAutoConsoleCommand CmdBenchKillCam(
+	TEXT("Shooter.BenchKillCam"),
+	TEXT("Shooter.BenchKillCam [Frames=100000]: kill-cam frame encode and decode cost, quantization error and memory per character."),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args) {
+
+		const int32 NumFrames = FMath::Max(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 100000, 1);
+
+		FRandomStream Stream(1234);
+		TArray<FVector> Locations;
+		TArray<FRotator> AimRotations;
+		Locations.SetNumUninitialized(NumFrames);
+		AimRotations.SetNumUninitialized(NumFrames);
+		for (int32 i = 0; i < NumFrames; i++) {
+
+			Locations[i] = FVector(Stream.FRandRange(-50'000.f, 50'000.f), Stream.FRandRange(-50'000.f, 50'000.f), Stream.FRandRange(-2000.f, 5000.f));
+			AimRotations[i] = FRotator(Stream.FRandRange(-89.f, 89.f), Stream.FRandRange(-180.f, 180.f), 0.f);
+
+		}
+
+		TArray<FKillCamFrame> Encoded;
+		TArray<FKillCamDecodedFrame> Decoded;
+		Encoded.SetNumUninitialized(NumFrames);
+		Decoded.SetNumUninitialized(NumFrames);
+
+		uint64 StartCycles = FPlatformTime::Cycles64();
+		for (int32 i = 0; i < NumFrames; i++) {
+			UShooterKillCamComponent::Encode(Encoded[i], 1.f / 30.f, Locations[i], AimRotations[i].Yaw, AimRotations[i], FKillCamFrame::Aiming);
+		}
+		const double EncodeMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+
+		StartCycles = FPlatformTime::Cycles64();
+		for (int32 i = 0; i < NumFrames; i++) {
+			UShooterKillCamComponent::Decode(Encoded[i], Decoded[i]);
+		}
+		const double DecodeMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+
+		float MaxLocationError = 0.f;
+		float MaxAngleError = 0.f;
+		for (int32 i = 0; i < NumFrames; i++) {
+
+			MaxLocationError = FMath::Max(MaxLocationError, FVector::Dist(Locations[i], Decoded[i].Location));
+			MaxAngleError = FMath::Max(MaxAngleError, FMath::Abs(FRotator::NormalizeAxis(Decoded[i].AimRotation.Pitch - AimRotations[i].Pitch)));
+			MaxAngleError = FMath::Max(MaxAngleError, FMath::Abs(FRotator::NormalizeAxis(Decoded[i].AimRotation.Yaw - AimRotations[i].Yaw)));
+
+		}
+
+		const UShooterKillCamComponent* Defaults = GetDefault<UShooterKillCamComponent>();
+		UE_LOG(LogShooter, Display, TEXT("Kill-cam bench: %d frames, encode %.1f ns, decode %.1f ns per frame, max error %.2f cm / %.3f deg, %d bytes per frame, budget %d bytes per character"),
+			NumFrames,
+			EncodeMs * 1000000.0 / NumFrames,
+			DecodeMs * 1000000.0 / NumFrames,
+			MaxLocationError,
+			MaxAngleError,
+			(int32)sizeof(FKillCamFrame),
+			Defaults->GetMaxBytes());
+
+	}));
@@ -0,0 +1,122 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "ShooterKillCamComponent.generated.h"
+
+/**
+ * One recorded moment, 18 bytes: location in centimeters as 24-bit signed integers (+-83 km),
+ * angles as 16-bit fractions of a turn, and the time since the previous frame.
+ */
+struct FKillCamFrame
+{
+	uint16 DeltaMs;
+	uint16 ActorYaw;
+	uint16 AimYaw;
+	uint16 AimPitch;
+	uint8 Location[9];
+	uint8 Flags;
+
+	enum : uint8 {
+		Aiming = 1 << 0,
+		Fired = 1 << 1 // at least one shot since the previous frame
+	};
+};
+static_assert(sizeof(FKillCamFrame) == 18, "FKillCamFrame is sized for the memory budget");
+
+struct FKillCamDecodedFrame
+{
+	float Seconds = 0.f; // since the oldest frame
+	FVector Location = FVector::ZeroVector;
+	float ActorYaw = 0.f;
+	FRotator AimRotation = FRotator::ZeroRotator;
+	bool bAiming = false;
+	bool bFired = false;
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FKillCamShot, FVector, EyeLocation, FRotator, AimRotation);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FKillCamFinished);
+
+/**
+ * Keeps the last RecordSeconds of its character in a fixed ring of quantized frames, sized once and
+ * clamped to MaxBytes. StartPlayback replays them from the character's eyes through a camera
+ * actor on the given player, for a kill-cam of whoever did the killing. Not recorded on a
+ * dedicated server.
+ */
+UCLASS(ClassGroup = (Shooter), meta = (BlueprintSpawnableComponent))
+class THELASTSHOOTER_API UShooterKillCamComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UShooterKillCamComponent();
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	//called from FireWeapon, lands in the next recorded frame
+	FORCEINLINE void NotifyFired() { bFiredSinceLastFrame = true; }
+
+	UFUNCTION(BlueprintCallable, Category = KillCam)
+	void StartPlayback(APlayerController* Viewer);
+
+	UFUNCTION(BlueprintCallable, Category = KillCam)
+	void StopPlayback();
+
+	UFUNCTION(BlueprintPure, Category = KillCam)
+	bool IsPlayingBack() const { return PlaybackCamera != nullptr; }
+
+	//oldest first
+	void Decode(TArray<FKillCamDecodedFrame>& OutFrames) const;
+
+	FORCEINLINE int32 GetCapacity() const { return Frames.Num(); }
+	FORCEINLINE int32 GetNumRecorded() const { return NumRecorded; }
+	FORCEINLINE SIZE_T GetAllocatedBytes() const { return Frames.GetAllocatedSize(); }
+	FORCEINLINE int32 GetMaxBytes() const { return MaxBytes; }
+
+	static void Encode(FKillCamFrame& OutFrame, float DeltaSeconds, const FVector& Location, float ActorYaw, const FRotator& AimRotation, uint8 Flags);
+	static void Decode(const FKillCamFrame& Frame, FKillCamDecodedFrame& OutFrame);
+
+	UPROPERTY(BlueprintAssignable, Category = KillCam)
+	FKillCamShot OnPlaybackShot;
+
+	UPROPERTY(BlueprintAssignable, Category = KillCam)
+	FKillCamFinished OnPlaybackFinished;
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	void Record();
+	void TickPlayback(float DeltaTime);
+
+	UPROPERTY(EditDefaultsOnly, Category = KillCam, meta = (AllowPrivateAccess = "true", ClampMin = "1.0"))
+	float RecordSeconds;
+
+	UPROPERTY(EditDefaultsOnly, Category = KillCam, meta = (AllowPrivateAccess = "true", ClampMin = "1.0", ClampMax = "120.0"))
+	float RecordHz;
+
+	//per character, the ring is shortened to fit
+	UPROPERTY(EditDefaultsOnly, Category = KillCam, meta = (AllowPrivateAccess = "true"))
+	int32 MaxBytes;
+
+	TArray<FKillCamFrame> Frames;
+	int32 NextFrame;
+	int32 NumRecorded;
+	float LastRecordSeconds;
+	bool bFiredSinceLastFrame;
+
+	//playback
+	UPROPERTY(Transient)
+	class ACameraActor* PlaybackCamera;
+
+	UPROPERTY(Transient)
+	APlayerController* PlaybackViewer;
+
+	TArray<FKillCamDecodedFrame> PlaybackFrames;
+	float PlaybackSeconds;
+	int32 PlaybackIndex;
+	float PlaybackEyeHeight;
+};
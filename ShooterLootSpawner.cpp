@@ -0,0 +1,171 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterLootSpawner.h"
+#include "TheLastShooter.h"
+#include "ShooterPerf.h"
+#include "Item.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("LootSpawn"), STAT_LootSpawn, STATGROUP_TheLastShooter);
+
+static float GShooterLootBudgetMs = 2.f;
+static FAutoConsoleVariableRef CVarShooterLootBudgetMs(
+	TEXT("Shooter.Loot.BudgetMs"),
+	GShooterLootBudgetMs,
+	TEXT("Game thread milliseconds per frame the loot spawner may spend, at least one item always spawns."));
+
+//players move, the nearest-first order is refreshed this often while spawning
+static const int32 ResortIntervalFrames = 30;
+
+UShooterLootSpawner* UShooterLootSpawner::Get(const UObject* WorldContextObject)
+{
+
+	UWorld* World = GEngine ? GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::LogAndReturnNull) : nullptr;
+	return World ? World->GetSubsystem<UShooterLootSpawner>() : nullptr;
+
+}
+
+void UShooterLootSpawner::Initialize(FSubsystemCollectionBase& Collection)
+{
+
+	Super::Initialize(Collection);
+	TickStartHandle = FWorldDelegates::OnWorldTickStart.AddUObject(this, &UShooterLootSpawner::OnWorldTickStart);
+
+}
+
+void UShooterLootSpawner::Deinitialize()
+{
+
+	FWorldDelegates::OnWorldTickStart.Remove(TickStartHandle);
+	Pending.Reset();
+	Super::Deinitialize();
+
+}
+
+void UShooterLootSpawner::QueueSpawns(const TArray<FShooterLootSpawnRow>& Requests)
+{
+
+	if (Pending.Num() == 0) {
+
+		//new batch, progress starts over
+		NumRequested = 0;
+		NumSpawned = 0;
+		NumSpawnFrames = 0;
+		TotalSpawnMs = 0.0;
+		MaxFrameSpawnMs = 0.0;
+
+	}
+
+	for (const FShooterLootSpawnRow& Request : Requests) {
+
+		if (Request.ItemClass) {
+			Pending.Add({ Request, 0.f });
+			NumRequested++;
+		}
+
+	}
+	bNeedsSort = true;
+
+}
+
+void UShooterLootSpawner::QueueSpawnsFromTable(const UDataTable* LootTable)
+{
+
+	if (LootTable == nullptr) {
+		return;
+	}
+
+	TArray<FShooterLootSpawnRow*> Rows;
+	LootTable->GetAllRows<FShooterLootSpawnRow>(TEXT("QueueSpawnsFromTable"), Rows);
+
+	TArray<FShooterLootSpawnRow> Requests;
+	Requests.Reserve(Rows.Num());
+	for (const FShooterLootSpawnRow* Row : Rows) {
+		Requests.Add(*Row);
+	}
+	QueueSpawns(Requests);
+
+}
+
+float UShooterLootSpawner::GetProgress() const
+{
+	return NumRequested > 0 ? (float)NumSpawned / NumRequested : 1.f;
+}
+
+void UShooterLootSpawner::OnWorldTickStart(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+
+	if (World == GetWorld() && Pending.Num() > 0) {
+		SpawnWithinBudget();
+	}
+
+}
+
+void UShooterLootSpawner::SortByPlayerDistance()
+{
+
+	TArray<FVector> ViewLocations;
+	ShooterWorld::GetPlayerViewLocations(GetWorld(), ViewLocations);
+	if (ViewLocations.Num() > 0) {
+
+		for (FPendingSpawn& Spawn : Pending) {
+			Spawn.DistSquared = ShooterWorld::GetDistSquaredToNearest(Spawn.Row.Location, ViewLocations);
+		}
+
+		Pending.Sort([](const FPendingSpawn& A, const FPendingSpawn& B) {
+			return A.DistSquared > B.DistSquared;
+		});
+
+	}
+
+	bNeedsSort = false;
+	FramesSinceSort = 0;
+
+}
+
+void UShooterLootSpawner::SpawnWithinBudget()
+{
+	SCOPE_CYCLE_COUNTER(STAT_LootSpawn);
+	FShooterFrameCounters::Get().NoteEvent(TEXT("LootSpawn"));
+
+	const double StartSeconds = FPlatformTime::Seconds();
+
+	if (bNeedsSort || ++FramesSinceSort >= ResortIntervalFrames) {
+		SortByPlayerDistance();
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+
+	const double EndSeconds = StartSeconds + GShooterLootBudgetMs / 1000.0;
+	do {
+
+		const FShooterLootSpawnRow Request = Pending.Pop(false).Row;
+		GetWorld()->SpawnActor<AItem>(Request.ItemClass, Request.Location, Request.Rotation, SpawnParams);
+		NumSpawned++;
+
+	} while (Pending.Num() > 0 && FPlatformTime::Seconds() < EndSeconds);
+
+	const double FrameMs = (FPlatformTime::Seconds() - StartSeconds) * 1000.0;
+	NumSpawnFrames++;
+	TotalSpawnMs += FrameMs;
+	MaxFrameSpawnMs = FMath::Max(MaxFrameSpawnMs, FrameMs);
+
+	OnProgress.Broadcast(NumSpawned, NumRequested);
+
+	if (Pending.Num() == 0) {
+
+		Pending.Shrink();
+		UE_LOG(LogShooter, Log, TEXT("Loot spawner: %d items in %.2f ms over %d frames, worst frame %.2f ms"),
+			NumSpawned,
+			TotalSpawnMs,
+			NumSpawnFrames,
+			MaxFrameSpawnMs);
+		OnComplete.Broadcast(NumSpawned);
+
+	}
+
+}
@@ -0,0 +1,90 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Engine/DataTable.h"
+#include "ShooterLootSpawner.generated.h"
+
+/** One pickup to spawn, also the row type of loot data tables */
+USTRUCT(BlueprintType)
+struct FShooterLootSpawnRow : public FTableRowBase
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Loot)
+	TSubclassOf<class AItem> ItemClass;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Loot)
+	FVector Location = FVector::ZeroVector;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Loot)
+	FRotator Rotation = FRotator::ZeroRotator;
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FShooterLootSpawnProgress, int32, NumSpawned, int32, NumRequested);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FShooterLootSpawnComplete, int32, NumSpawned);
+
+/**
+ * Spawns pickups a few at a time: every frame spends at most Shooter.Loot.BudgetMs on SpawnActor
+ * and the item's BeginPlay, nearest to a player first. Progress is broadcast after every frame
+ * that spawned something, completion once the queue runs dry.
+ */
+UCLASS()
+class THELASTSHOOTER_API UShooterLootSpawner : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	static UShooterLootSpawner* Get(const UObject* WorldContextObject);
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	UFUNCTION(BlueprintCallable, Category = Loot)
+	void QueueSpawns(const TArray<FShooterLootSpawnRow>& Requests);
+
+	//every row of a table with FShooterLootSpawnRow rows
+	UFUNCTION(BlueprintCallable, Category = Loot)
+	void QueueSpawnsFromTable(const UDataTable* LootTable);
+
+	UFUNCTION(BlueprintPure, Category = Loot)
+	bool IsSpawning() const { return Pending.Num() > 0; }
+
+	//0 to 1 over everything queued since the spawner was last idle
+	UFUNCTION(BlueprintPure, Category = Loot)
+	float GetProgress() const;
+
+	UPROPERTY(BlueprintAssignable, Category = Loot)
+	FShooterLootSpawnProgress OnProgress;
+
+	UPROPERTY(BlueprintAssignable, Category = Loot)
+	FShooterLootSpawnComplete OnComplete;
+
+private:
+	void OnWorldTickStart(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+	void SortByPlayerDistance();
+	void SpawnWithinBudget();
+
+	struct FPendingSpawn
+	{
+		FShooterLootSpawnRow Row;
+		float DistSquared = 0.f;
+	};
+
+	//farthest first, spawning pops from the back
+	TArray<FPendingSpawn> Pending;
+
+	FDelegateHandle TickStartHandle;
+
+	int32 NumRequested = 0;
+	int32 NumSpawned = 0;
+	int32 FramesSinceSort = 0;
+	bool bNeedsSort = false;
+
+	//for the completion log line
+	int32 NumSpawnFrames = 0;
+	double TotalSpawnMs = 0.0;
+	double MaxFrameSpawnMs = 0.0;
+};
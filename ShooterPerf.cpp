@@ -0,0 +1,298 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterPerf.h"
+#include "TheLastShooter.h"
+#include "Misc/CoreDelegates.h"
+#include "HAL/IConsoleManager.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "HAL/PlatformMemory.h"
+
+CSV_DEFINE_CATEGORY(ShooterFireLatency, true);
+
+static float GShooterHitchBudgetMs = 33.3f;
+static FAutoConsoleVariableRef CVarShooterHitchBudgetMs(
+	TEXT("Shooter.Hitch.BudgetMs"),
+	GShooterHitchBudgetMs,
+	TEXT("Game thread frames longer than this are logged with the gameplay events they ran, 0 = off."));
+
+FShooterPercentiles FShooterPercentiles::Compute(TArray<float>& Samples)
+{
+
+	FShooterPercentiles Result;
+	Result.Num = Samples.Num();
+	if (Result.Num == 0) {
+		return Result;
+	}
+
+	Samples.Sort();
+
+	auto NearestRank = [&Samples](float Percentile) {
+		const int32 Rank = FMath::CeilToInt(Percentile * Samples.Num()) - 1;
+		return Samples[FMath::Clamp(Rank, 0, Samples.Num() - 1)];
+	};
+
+	Result.P50 = NearestRank(0.5f);
+	Result.P90 = NearestRank(0.9f);
+	Result.P95 = NearestRank(0.95f);
+	Result.P99 = NearestRank(0.99f);
+	Result.Max = Samples.Last();
+	return Result;
+
+}
+
+FString FShooterPercentiles::ToString() const
+{
+	return FString::Printf(TEXT("n=%d p50=%.3fms p90=%.3fms p95=%.3fms p99=%.3fms max=%.3fms"), Num, P50, P90, P95, P99, Max);
+}
+
+FShooterFrameCounters& FShooterFrameCounters::Get()
+{
+	static FShooterFrameCounters Counters;
+	return Counters;
+}
+
+FShooterFrameCounters::FShooterFrameCounters() :
+	FrameStartCycles(0),
+	FrameHistoryHead(0)
+{
+
+	FrameMsHistory.Reserve(FrameHistoryCapacity);
+	FCoreDelegates::OnBeginFrame.AddRaw(this, &FShooterFrameCounters::OnBeginFrame);
+	FCoreDelegates::OnEndFrame.AddRaw(this, &FShooterFrameCounters::OnEndFrame);
+
+}
+
+void FShooterFrameCounters::OnBeginFrame()
+{
+
+	Last = Current;
+	Current = FShooterFrameCounts();
+	CurrentEvents.Reset();
+	FrameStartCycles = FPlatformTime::Cycles64();
+
+}
+
+void FShooterFrameCounters::OnEndFrame()
+{
+
+	if (FrameStartCycles == 0) {
+		return;
+	}
+
+	Current.FrameMs = (float)FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - FrameStartCycles);
+
+	if (FrameMsHistory.Num() < FrameHistoryCapacity) {
+		FrameMsHistory.Add(Current.FrameMs);
+	}
+	else {
+		FrameMsHistory[FrameHistoryHead] = Current.FrameMs;
+	}
+	FrameHistoryHead = (FrameHistoryHead + 1) % FrameHistoryCapacity;
+
+	if (GShooterHitchBudgetMs > 0.f && Current.FrameMs > GShooterHitchBudgetMs) {
+		LogHitch();
+	}
+
+}
+
+void FShooterFrameCounters::NoteEvent(const TCHAR* Event)
+{
+
+	if (CurrentEvents.Num() < MaxEventsPerFrame) {
+		CurrentEvents.AddUnique(Event);
+	}
+
+}
+
+void FShooterFrameCounters::LogHitch() const
+{
+
+	FString Events;
+	for (const TCHAR* Event : CurrentEvents) {
+
+		if (!Events.IsEmpty()) {
+			Events += TEXT(", ");
+		}
+		Events += Event;
+
+	}
+
+	UE_LOG(LogShooter, Warning, TEXT("Hitch: frame %llu took %.2f ms (budget %.2f ms) during %s; traces %d, emitters %d, item state transitions %d"),
+		GFrameCounter,
+		Current.FrameMs,
+		GShooterHitchBudgetMs,
+		Events.IsEmpty() ? TEXT("no gameplay event") : *Events,
+		Current.Traces,
+		Current.Emitters,
+		Current.ItemStateTransitions);
+	CSV_EVENT(TheLastShooter, TEXT("Hitch %.2fms: %s"), Current.FrameMs, *Events);
+
+}
+
+FShooterPercentiles FShooterFrameCounters::GetFrameMsPercentiles() const
+{
+
+	TArray<float> Samples = FrameMsHistory;
+	return FShooterPercentiles::Compute(Samples);
+
+}
+
+void FShooterFrameCounters::LogPerfReport() const
+{
+
+	const FPlatformMemoryStats MemoryStats = FPlatformMemory::GetStats();
+	UE_LOG(LogShooter, Display, TEXT("Perf report (%s%s): used physical %.1f MB, peak %.1f MB, game thread %s"),
+		IsRunningDedicatedServer() ? TEXT("dedicated server") : TEXT("client"),
+		WITH_SHOOTER_COSMETICS ? TEXT(", cosmetics") : TEXT(", no cosmetics"),
+		MemoryStats.UsedPhysical / (1024.f * 1024.f),
+		MemoryStats.PeakUsedPhysical / (1024.f * 1024.f),
+		*GetFrameMsPercentiles().ToString());
+
+}
+
+FFireLatencyTracker& FFireLatencyTracker::Get()
+{
+	static FFireLatencyTracker Tracker;
+	return Tracker;
+}
+
+FFireLatencyTracker::FFireLatencyTracker() :
+	Head(0),
+	Num(0)
+{
+
+	for (TArray<float>& Ring : StageMs) {
+		Ring.SetNumZeroed(Capacity);
+	}
+
+	FCoreDelegates::OnEndFrame.AddRaw(this, &FFireLatencyTracker::OnEndFrame);
+
+}
+
+void FFireLatencyTracker::Submit(const FFireLatencySample& Sample)
+{
+
+	if (Sample.IsStarted()) {
+		PendingSamples.Add(Sample);
+	}
+
+}
+
+void FFireLatencyTracker::OnEndFrame()
+{
+
+	if (PendingSamples.Num() == 0) {
+		return;
+	}
+
+	const uint64 EndOfFrameCycles = FPlatformTime::Cycles64();
+	for (FFireLatencySample& Sample : PendingSamples) {
+
+		Sample.Cycles[(int32)EFireLatencyStage::EFLS_EndOfFrame] = EndOfFrameCycles;
+		AddToRing(Sample);
+
+	}
+
+	CSV_CUSTOM_STAT(ShooterFireLatency, ShotsFired, PendingSamples.Num(), ECsvCustomStatOp::Set);
+	PendingSamples.Reset();
+
+}
+
+void FFireLatencyTracker::AddToRing(const FFireLatencySample& Sample)
+{
+
+	const uint64 InputCycles = Sample.Cycles[(int32)EFireLatencyStage::EFLS_Input];
+	for (int32 Stage = 0; Stage < (int32)EFireLatencyStage::EFLS_Max; Stage++) {
+
+		const uint64 StageCycles = Sample.Cycles[Stage];
+		StageMs[Stage][Head] = StageCycles ? (float)FPlatformTime::ToMilliseconds64(StageCycles - InputCycles) : -1.f;
+
+	}
+
+	CSV_CUSTOM_STAT(ShooterFireLatency, InputToTracesMs, StageMs[(int32)EFireLatencyStage::EFLS_Traces][Head], ECsvCustomStatOp::Max);
+	CSV_CUSTOM_STAT(ShooterFireLatency, InputToEmittersMs, StageMs[(int32)EFireLatencyStage::EFLS_Emitters][Head], ECsvCustomStatOp::Max);
+	CSV_CUSTOM_STAT(ShooterFireLatency, InputToEndOfFrameMs, StageMs[(int32)EFireLatencyStage::EFLS_EndOfFrame][Head], ECsvCustomStatOp::Max);
+
+	Head = (Head + 1) % Capacity;
+	Num = FMath::Min(Num + 1, Capacity);
+
+}
+
+FShooterPercentiles FFireLatencyTracker::GetPercentiles(EFireLatencyStage Stage) const
+{
+
+	TArray<float> Samples;
+	Samples.Reserve(Num);
+	for (int32 i = 0; i < Num; i++) {
+
+		const float Ms = StageMs[(int32)Stage][i];
+		if (Ms >= 0.f) {
+			Samples.Add(Ms);
+		}
+
+	}
+
+	return FShooterPercentiles::Compute(Samples);
+
+}
+
+void FFireLatencyTracker::Reset()
+{
+
+	Head = 0;
+	Num = 0;
+	PendingSamples.Reset();
+
+}
+
+void FFireLatencyTracker::DumpToLog() const
+{
+
+	UE_LOG(LogShooter, Log, TEXT("Fire latency over the last %d shots (relative to input):"), Num);
+	for (int32 Stage = 0; Stage < (int32)EFireLatencyStage::EFLS_Max; Stage++) {
+
+		UE_LOG(LogShooter, Log, TEXT("  %-12s %s"),
+			GetStageName((EFireLatencyStage)Stage),
+			*GetPercentiles((EFireLatencyStage)Stage).ToString());
+
+	}
+
+}
+
+const TCHAR* FFireLatencyTracker::GetStageName(EFireLatencyStage Stage)
+{
+
+	switch (Stage) {
+	case EFireLatencyStage::EFLS_Input: return TEXT("Input");
+	case EFireLatencyStage::EFLS_FireTimer: return TEXT("FireTimer");
+	case EFireLatencyStage::EFLS_Traces: return TEXT("Traces");
+	case EFireLatencyStage::EFLS_Emitters: return TEXT("Emitters");
+	case EFireLatencyStage::EFLS_Montage: return TEXT("Montage");
+	case EFireLatencyStage::EFLS_EndOfFrame: return TEXT("EndOfFrame");
+	}
+	return TEXT("Unknown");
+
+}
+
+static FAutoConsoleCommand CmdFireLatency(
+	TEXT("Shooter.FireLatency"),
+	TEXT("Logs fire path latency percentiles per stage. 'Shooter.FireLatency reset' clears the samples."),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args) {
+
+		if (Args.Num() > 0 && Args[0] == TEXT("reset")) {
+			FFireLatencyTracker::Get().Reset();
+			return;
+		}
+		FFireLatencyTracker::Get().DumpToLog();
+
+	}));
+
+static FAutoConsoleCommand CmdPerfReport(
+	TEXT("Shooter.PerfReport"),
+	TEXT("Logs process memory and game thread time percentiles over the last frames."),
+	FConsoleCommandDelegate::CreateLambda([]() {
+
+		FShooterFrameCounters::Get().LogPerfReport();
+
+	}));
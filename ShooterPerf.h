@@ -0,0 +1,170 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "TheLastShooter.h"
+
+/** Nearest-rank percentiles of a set of millisecond samples */
+struct THELASTSHOOTER_API FShooterPercentiles
+{
+	int32 Num = 0;
+	float P50 = 0.f;
+	float P90 = 0.f;
+	float P95 = 0.f;
+	float P99 = 0.f;
+	float Max = 0.f;
+
+	//sorts Samples in place
+	static FShooterPercentiles Compute(TArray<float>& Samples);
+
+	FString ToString() const;
+};
+
+/** Gameplay work done during one frame */
+struct FShooterFrameCounts
+{
+	int32 Traces = 0;
+	int32 Emitters = 0;
+	int32 ItemStateTransitions = 0;
+	int32 DamageQueued = 0;
+	int32 DamageApplied = 0;
+
+	//game thread time between the begin and end of frame delegates, without idle time
+	float FrameMs = 0.f;
+};
+
+/**
+ * Per-frame gameplay counters, rolled over when a new frame begins. Every count is mirrored into
+ * STATGROUP_TheLastShooter and the TheLastShooter CSV category. Game thread only.
+ */
+class THELASTSHOOTER_API FShooterFrameCounters
+{
+public:
+	static FShooterFrameCounters& Get();
+
+	FORCEINLINE void AddTraces(int32 Count = 1)
+	{
+		Current.Traces += Count;
+		INC_DWORD_STAT_BY(STAT_ShooterTraces, Count);
+		CSV_CUSTOM_STAT(TheLastShooter, Traces, Count, ECsvCustomStatOp::Accumulate);
+	}
+
+	FORCEINLINE void AddEmitters(int32 Count = 1)
+	{
+		Current.Emitters += Count;
+		INC_DWORD_STAT_BY(STAT_ShooterEmitters, Count);
+		CSV_CUSTOM_STAT(TheLastShooter, Emitters, Count, ECsvCustomStatOp::Accumulate);
+	}
+
+	FORCEINLINE void AddItemStateTransition()
+	{
+		Current.ItemStateTransitions++;
+		INC_DWORD_STAT(STAT_ShooterItemStateTransitions);
+		CSV_CUSTOM_STAT(TheLastShooter, ItemStateTransitions, 1, ECsvCustomStatOp::Accumulate);
+	}
+
+	FORCEINLINE void AddDamageQueued()
+	{
+		Current.DamageQueued++;
+		INC_DWORD_STAT(STAT_ShooterDamageQueued);
+		CSV_CUSTOM_STAT(TheLastShooter, DamageQueued, 1, ECsvCustomStatOp::Accumulate);
+	}
+
+	FORCEINLINE void AddDamageApplied()
+	{
+		Current.DamageApplied++;
+		INC_DWORD_STAT(STAT_ShooterDamageApplied);
+		CSV_CUSTOM_STAT(TheLastShooter, DamageApplied, 1, ECsvCustomStatOp::Accumulate);
+	}
+
+	//names the gameplay work running this frame for the hitch log, Event must be a string literal
+	void NoteEvent(const TCHAR* Event);
+
+	//counts of the last completed frame
+	FORCEINLINE const FShooterFrameCounts& GetLastFrame() const { return Last; }
+
+	//over the last FrameHistoryCapacity frames
+	FShooterPercentiles GetFrameMsPercentiles() const;
+
+	//memory and frame time, for before/after comparisons of server builds
+	void LogPerfReport() const;
+
+private:
+	FShooterFrameCounters();
+
+	void OnBeginFrame();
+	void OnEndFrame();
+
+	static constexpr int32 FrameHistoryCapacity = 600;
+	static constexpr int32 MaxEventsPerFrame = 8;
+
+	void LogHitch() const;
+
+	FShooterFrameCounts Current;
+	FShooterFrameCounts Last;
+
+	TArray<const TCHAR*, TInlineAllocator<MaxEventsPerFrame>> CurrentEvents;
+
+	uint64 FrameStartCycles;
+	TArray<float> FrameMsHistory;
+	int32 FrameHistoryHead;
+};
+
+enum class EFireLatencyStage : uint8 {
+	EFLS_Input, // FireButtonPressed, or the automatic fire reset for held triggers
+	EFLS_FireTimer, // StartFireTimer let the shot through
+	EFLS_Traces, // GetBeamEndLocation returned
+	EFLS_Emitters, // muzzle flash, impact and beam spawned
+	EFLS_Montage, // HipFireMontage started
+	EFLS_EndOfFrame, // game thread finished the frame the shot went out in
+
+	EFLS_Max
+};
+
+/** Timestamps of one shot going through the fire path, 0 = stage not reached */
+struct FFireLatencySample
+{
+	uint64 Cycles[(int32)EFireLatencyStage::EFLS_Max] = {};
+
+	FORCEINLINE void Mark(EFireLatencyStage Stage) { Cycles[(int32)Stage] = FPlatformTime::Cycles64(); }
+	FORCEINLINE bool IsStarted() const { return Cycles[(int32)EFireLatencyStage::EFLS_Input] != 0; }
+	FORCEINLINE void Reset() { *this = FFireLatencySample(); }
+};
+
+/**
+ * Ring buffer of the most recent shots' input-to-stage latencies.
+ * Read it with the "Shooter.FireLatency" console command or from CSV profiler captures
+ * (category ShooterFireLatency). Game thread only.
+ */
+class THELASTSHOOTER_API FFireLatencyTracker
+{
+public:
+	static FFireLatencyTracker& Get();
+
+	//takes a finished shot, EFLS_EndOfFrame gets stamped when the current frame ends
+	void Submit(const FFireLatencySample& Sample);
+
+	FShooterPercentiles GetPercentiles(EFireLatencyStage Stage) const;
+
+	void Reset();
+	void DumpToLog() const;
+
+	static const TCHAR* GetStageName(EFireLatencyStage Stage);
+
+private:
+	FFireLatencyTracker();
+
+	void OnEndFrame();
+	void AddToRing(const FFireLatencySample& Sample);
+
+	static constexpr int32 Capacity = 512;
+
+	//ms from input to each stage, one ring per stage, negative = stage skipped
+	TArray<float> StageMs[(int32)EFireLatencyStage::EFLS_Max];
+	int32 Head;
+	int32 Num;
+
+	//shots waiting for the end of their frame
+	TArray<FFireLatencySample> PendingSamples;
+};
@@ -0,0 +1,161 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterPickupInstancer.h"
+#include "TheLastShooter.h"
+#include "Item.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "Engine/StaticMesh.h"
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+
+static int32 GShooterPickupsInstanced = 1;
+static FAutoConsoleVariableRef CVarShooterPickupsInstanced(
+	TEXT("Shooter.Pickups.Instanced"),
+	GShooterPickupsInstanced,
+	TEXT("1 = idle ground pickups with a GroundStaticMesh draw as shared instances, 0 = every item draws its own mesh. Applies on the next item state change."));
+
+UShooterPickupInstancer* UShooterPickupInstancer::Get(const UObject* WorldContextObject)
+{
+
+	UWorld* World = GEngine ? GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::LogAndReturnNull) : nullptr;
+	return World ? World->GetSubsystem<UShooterPickupInstancer>() : nullptr;
+
+}
+
+bool UShooterPickupInstancer::IsEnabled()
+{
+	//nothing is drawn on a dedicated server
+	return WITH_SHOOTER_COSMETICS && GShooterPickupsInstanced != 0 && !IsRunningDedicatedServer();
+}
+
+void UShooterPickupInstancer::Deinitialize()
+{
+
+	Meshes.Reset();
+	Components.Reset();
+	HostActor = nullptr;
+	Super::Deinitialize();
+
+}
+
+UShooterPickupInstancer::FMeshInstances& UShooterPickupInstancer::FindOrAddMesh(UStaticMesh* Mesh)
+{
+
+	FMeshInstances& MeshInstances = Meshes.FindOrAdd(Mesh);
+	if (MeshInstances.Component) {
+		return MeshInstances;
+	}
+
+	if (HostActor == nullptr) {
+
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.Name = TEXT("ShooterPickupInstances");
+		SpawnParams.ObjectFlags = RF_Transient;
+		HostActor = GetWorld()->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParams);
+		HostActor->SetRootComponent(NewObject<USceneComponent>(HostActor, TEXT("Root")));
+		HostActor->GetRootComponent()->RegisterComponent();
+
+	}
+
+	UHierarchicalInstancedStaticMeshComponent* Component = NewObject<UHierarchicalInstancedStaticMeshComponent>(HostActor);
+	Component->SetStaticMesh(Mesh);
+	//focus and overlaps stay on each item's own collision box and area sphere
+	Component->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Component->SetMobility(EComponentMobility::Movable);
+	Component->SetupAttachment(HostActor->GetRootComponent());
+	Component->RegisterComponent();
+
+	MeshInstances.Component = Component;
+	Components.Add(Component);
+	return MeshInstances;
+
+}
+
+bool UShooterPickupInstancer::AddInstance(AItem* Item)
+{
+
+	UStaticMesh* Mesh = Item->GetGroundStaticMesh();
+	if (Mesh == nullptr || Item->GroundInstanceIndex != INDEX_NONE) {
+		return false;
+	}
+
+	FMeshInstances& MeshInstances = FindOrAddMesh(Mesh);
+	Item->GroundInstanceIndex = MeshInstances.Component->AddInstanceWorldSpace(Item->GetItemMesh()->GetComponentTransform());
+	check(Item->GroundInstanceIndex == MeshInstances.Items.Num());
+	MeshInstances.Items.Add(Item);
+	return true;
+
+}
+
+void UShooterPickupInstancer::RemoveInstance(AItem* Item)
+{
+
+	FMeshInstances* MeshInstances = Meshes.Find(Item->GetGroundStaticMesh());
+	const int32 Index = Item->GroundInstanceIndex;
+	Item->GroundInstanceIndex = INDEX_NONE;
+	if (MeshInstances == nullptr || !MeshInstances->Items.IsValidIndex(Index)) {
+		return;
+	}
+
+	//the component moves its last instance into the hole, the item that owned it follows
+	MeshInstances->Component->RemoveInstance(Index);
+	MeshInstances->Items.RemoveAtSwap(Index, 1, false);
+	if (MeshInstances->Items.IsValidIndex(Index)) {
+
+		if (AItem* MovedItem = MeshInstances->Items[Index].Get()) {
+			MovedItem->GroundInstanceIndex = Index;
+		}
+
+	}
+
+}
+
+void UShooterPickupInstancer::DumpToLog() const
+{
+
+	int32 NumItems = 0;
+	int32 NumOwnDrawn = 0;
+	for (TActorIterator<AItem> It(GetWorld()); It; ++It) {
+
+		NumItems++;
+		if (It->GroundInstanceIndex == INDEX_NONE && It->GetItemMesh()->IsVisible()) {
+			NumOwnDrawn++;
+		}
+
+	}
+
+	int32 NumInstances = 0;
+	int32 NumInstancedSections = 0;
+	for (const auto& Pair : Meshes) {
+
+		const int32 NumMeshInstances = Pair.Value.Items.Num();
+		const int32 NumSections = Pair.Key->GetNumSections(0);
+		NumInstances += NumMeshInstances;
+		NumInstancedSections += NumSections;
+		UE_LOG(LogShooter, Log, TEXT("  %-40s %d instances, %d sections"), *Pair.Key->GetName(), NumMeshInstances, NumSections);
+
+	}
+
+	//instanced components draw once per section, skeletal meshes once per section per item
+	UE_LOG(LogShooter, Log, TEXT("Pickups: %d items, %d instanced in %d components (~%d draws), %d with their own mesh component"),
+		NumItems,
+		NumInstances,
+		Meshes.Num(),
+		NumInstancedSections,
+		NumOwnDrawn);
+
+}
+
+static FAutoConsoleCommandWithWorldAndArgs CmdPickupInstancing(
+	TEXT("Shooter.PickupInstancing"),
+	TEXT("Logs instanced ground pickups per mesh, their components and draws, and items drawing their own mesh."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World) {
+
+		if (UShooterPickupInstancer* Instancer = World ? World->GetSubsystem<UShooterPickupInstancer>() : nullptr) {
+			Instancer->DumpToLog();
+		}
+
+	}));
@@ -0,0 +1,52 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ShooterPickupInstancer.generated.h"
+
+/**
+ * Draws idle ground pickups that share a GroundStaticMesh as instances of one hierarchical
+ * instanced static mesh component, instead of one skeletal mesh component per item. Items add
+ * themselves on entering EIS_PickUp and leave on any other state. Shooter.Pickups.Instanced
+ * turns it off for comparisons, "Shooter.PickupInstancing" logs component and draw counts.
+ */
+UCLASS()
+class THELASTSHOOTER_API UShooterPickupInstancer : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	static UShooterPickupInstancer* Get(const UObject* WorldContextObject);
+
+	static bool IsEnabled();
+
+	virtual void Deinitialize() override;
+
+	//false when the item has no ground mesh, sets the item's GroundInstanceIndex otherwise
+	bool AddInstance(class AItem* Item);
+	void RemoveInstance(AItem* Item);
+
+	void DumpToLog() const;
+
+private:
+	struct FMeshInstances
+	{
+		class UHierarchicalInstancedStaticMeshComponent* Component = nullptr;
+
+		//item per instance index, kept in step with the component's swap-with-last removal
+		TArray<TWeakObjectPtr<AItem>> Items;
+	};
+
+	FMeshInstances& FindOrAddMesh(class UStaticMesh* Mesh);
+
+	//owns the instanced components, spawned on first use
+	UPROPERTY(Transient)
+	AActor* HostActor;
+
+	UPROPERTY(Transient)
+	TArray<UHierarchicalInstancedStaticMeshComponent*> Components;
+
+	TMap<UStaticMesh*, FMeshInstances> Meshes;
+};
@@ -0,0 +1,359 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterServerGovernor.h"
+#include "TheLastShooter.h"
+#include "ShooterChar.h"
+#include "Item.h"
+#include "Weapon.h"
+#include "EngineUtils.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "Engine/NetDriver.h"
+#include "Misc/CoreDelegates.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("ServerGovernorNetFrequency"), STAT_ServerGovernorNetFrequency, STATGROUP_TheLastShooter);
+
+static int32 GShooterServerGovernorEnabled = 1;
+static FAutoConsoleVariableRef CVarShooterServerGovernorEnabled(
+	TEXT("Shooter.ServerGovernor.Enabled"),
+	GShooterServerGovernorEnabled,
+	TEXT("1 = a dedicated server adapts its tick rate to load and net update frequencies to what actors do, 0 = configured tick rate and actor defaults."));
+
+//a character slower than this is idle
+static const float MovingSpeedSquared = 10.f * 10.f;
+
+UShooterServerGovernor::UShooterServerGovernor() :
+	MinTickRate(20),
+	MaxTickRate(60),
+	TickRateStep(5),
+	HighLoadFraction(0.8f),
+	LowLoadFraction(0.5f),
+	EvaluateSeconds(2.f),
+	NetFrequencySeconds(0.25f),
+	FiringNetUpdateFrequency(60.f),
+	MovingNetUpdateFrequency(30.f),
+	IdleNetUpdateFrequency(5.f)
+{
+}
+
+UShooterServerGovernor* UShooterServerGovernor::Get(const UObject* WorldContextObject)
+{
+
+	UWorld* World = GEngine ? GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::LogAndReturnNull) : nullptr;
+	return World ? World->GetSubsystem<UShooterServerGovernor>() : nullptr;
+
+}
+
+bool UShooterServerGovernor::ShouldCreateSubsystem(UObject* Outer) const
+{
+
+	const UWorld* World = Cast<UWorld>(Outer);
+	return Super::ShouldCreateSubsystem(Outer) && IsRunningDedicatedServer() && World && World->IsGameWorld();
+
+}
+
+void UShooterServerGovernor::Initialize(FSubsystemCollectionBase& Collection)
+{
+
+	Super::Initialize(Collection);
+	TickStartHandle = FWorldDelegates::OnWorldTickStart.AddUObject(this, &UShooterServerGovernor::OnWorldTickStart);
+	PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &UShooterServerGovernor::OnWorldPostActorTick);
+	EndFrameHandle = FCoreDelegates::OnEndFrame.AddUObject(this, &UShooterServerGovernor::OnEndFrame);
+
+}
+
+void UShooterServerGovernor::Deinitialize()
+{
+
+	FWorldDelegates::OnWorldTickStart.Remove(TickStartHandle);
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+	FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+	RestoreTickRate();
+	Activities.Reset();
+
+	Super::Deinitialize();
+
+}
+
+void UShooterServerGovernor::OnWorldTickStart(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+
+	if (World == GetWorld()) {
+		TickStartCycles = FPlatformTime::Cycles64();
+	}
+
+}
+
+void UShooterServerGovernor::OnEndFrame()
+{
+
+	if (TickStartCycles == 0) {
+		return;
+	}
+
+	//the world tick through the net driver's TickFlush, where replication runs, up to the end of the frame;
+	//the wait for the next tick comes before the next tick start and is not in it
+	TickCostMs += FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - TickStartCycles);
+	NumTicks++;
+	TickStartCycles = 0;
+
+}
+
+void UShooterServerGovernor::OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+
+	if (World != GetWorld()) {
+		return;
+	}
+
+	if (GShooterServerGovernorEnabled == 0) {
+
+		if (ConfiguredTickRate != 0 || Activities.Num() > 0) {
+
+			RestoreTickRate();
+			for (const TPair<TWeakObjectPtr<AActor>, EShooterNetActivity>& Entry : Activities) {
+
+				if (AActor* Actor = Entry.Key.Get()) {
+					Actor->NetUpdateFrequency = Actor->GetClass()->GetDefaultObject<AActor>()->NetUpdateFrequency;
+				}
+
+			}
+			Activities.Reset();
+			UE_LOG(LogShooter, Log, TEXT("Server governor off, tick rate and net update frequencies back to defaults"));
+
+		}
+		TickCostMs = 0.0;
+		NumTicks = 0;
+		return;
+
+	}
+
+	SecondsSinceNetFrequency += DeltaSeconds;
+	if (SecondsSinceNetFrequency >= NetFrequencySeconds) {
+		SecondsSinceNetFrequency = 0.f;
+		UpdateNetFrequencies();
+	}
+
+	SecondsSinceEvaluate += DeltaSeconds;
+	if (SecondsSinceEvaluate >= EvaluateSeconds && NumTicks > 0) {
+
+		LastAverageTickMs = (float)(TickCostMs / NumTicks);
+		UpdateTickRate(LastAverageTickMs);
+		SecondsSinceEvaluate = 0.f;
+		TickCostMs = 0.0;
+		NumTicks = 0;
+
+	}
+
+}
+
+void UShooterServerGovernor::UpdateTickRate(float AverageTickMs)
+{
+
+	UNetDriver* NetDriver = GetWorld()->GetNetDriver();
+	if (NetDriver == nullptr) {
+		return;
+	}
+
+	const int32 PreviousTickRate = CurrentTickRate;
+	if (ConfiguredTickRate == 0) {
+		ConfiguredTickRate = NetDriver->NetServerMaxTickRate;
+		CurrentTickRate = FMath::Clamp(ConfiguredTickRate, MinTickRate, MaxTickRate);
+	}
+
+	int32 NewTickRate = CurrentTickRate;
+	if (AverageTickMs > HighLoadFraction * 1000.f / CurrentTickRate) {
+		NewTickRate = FMath::Max(CurrentTickRate - TickRateStep, MinTickRate);
+	}
+	else if (AverageTickMs < LowLoadFraction * 1000.f / (CurrentTickRate + TickRateStep)) {
+		NewTickRate = FMath::Min(CurrentTickRate + TickRateStep, MaxTickRate);
+	}
+
+	CSV_CUSTOM_STAT(TheLastShooter, ServerTickCostMs, AverageTickMs, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(TheLastShooter, ServerTickRate, NewTickRate, ECsvCustomStatOp::Set);
+
+	if (NewTickRate != NetDriver->NetServerMaxTickRate) {
+
+		UE_LOG(LogShooter, Log, TEXT("Server governor: tick rate %d -> %d Hz, average tick %.2f ms of %.2f ms over %.1fs"),
+			NetDriver->NetServerMaxTickRate,
+			NewTickRate,
+			AverageTickMs,
+			1000.f / CurrentTickRate,
+			SecondsSinceEvaluate);
+		NetDriver->NetServerMaxTickRate = NewTickRate;
+		NumTickRateChanges++;
+
+	}
+
+	CurrentTickRate = NewTickRate;
+	if (CurrentTickRate != PreviousTickRate) {
+		//frequencies are capped at the tick rate, recap them now rather than at the next activity change
+		SecondsSinceNetFrequency = 0.f;
+		UpdateNetFrequencies();
+	}
+
+}
+
+void UShooterServerGovernor::RestoreTickRate()
+{
+
+	UNetDriver* NetDriver = GetWorld() ? GetWorld()->GetNetDriver() : nullptr;
+	if (NetDriver && ConfiguredTickRate != 0) {
+		NetDriver->NetServerMaxTickRate = ConfiguredTickRate;
+	}
+	ConfiguredTickRate = 0;
+	CurrentTickRate = 0;
+
+}
+
+void UShooterServerGovernor::UpdateNetFrequencies()
+{
+
+	SHOOTER_SCOPE_CYCLE_COUNTER(ServerGovernorNetFrequency);
+
+	for (TActorIterator<AShooterChar> It(GetWorld()); It; ++It) {
+
+		AShooterChar* Character = *It;
+		EShooterNetActivity Activity = EShooterNetActivity::ESNA_Idle;
+		if (Character->IsFiring()) {
+			Activity = EShooterNetActivity::ESNA_Firing;
+		}
+		else if (Character->GetVelocity().SizeSquared() > MovingSpeedSquared) {
+			Activity = EShooterNetActivity::ESNA_Moving;
+		}
+
+		SetNetActivity(Character, Activity);
+		if (AWeapon* Weapon = Character->GetEquipedWeapon()) {
+			SetNetActivity(Weapon, Activity);
+		}
+
+	}
+
+	for (TActorIterator<AItem> It(GetWorld()); It; ++It) {
+
+		//equipped weapons were done with their owner
+		AItem* Item = *It;
+		switch (Item->GetItemState()) {
+		case EItemState::EIS_PickUp:
+			SetNetActivity(Item, EShooterNetActivity::ESNA_Idle);
+			break;
+		case EItemState::EIS_EquipInterping:
+		case EItemState::EIS_Falling:
+			SetNetActivity(Item, EShooterNetActivity::ESNA_Moving);
+			break;
+		default:
+			break;
+		}
+
+	}
+
+	for (auto It = Activities.CreateIterator(); It; ++It) {
+
+		if (!It.Key().IsValid()) {
+			It.RemoveCurrent();
+		}
+
+	}
+
+}
+
+void UShooterServerGovernor::SetNetActivity(AActor* Actor, EShooterNetActivity Activity)
+{
+
+	EShooterNetActivity* Previous = Activities.Find(Actor);
+
+	//never more often than the server ticks
+	const float Frequency = CurrentTickRate > 0 ?
+		FMath::Min(GetNetUpdateFrequency(Activity), (float)CurrentTickRate) :
+		GetNetUpdateFrequency(Activity);
+
+	//same activity still needs the new cap after a tick rate change
+	if (Previous && *Previous == Activity && Actor->NetUpdateFrequency == Frequency) {
+		return;
+	}
+
+	UE_LOG(LogShooter, Verbose, TEXT("Server governor: %s %s -> %s, net update frequency %.0f -> %.0f"),
+		*Actor->GetName(),
+		Previous ? GetActivityName(*Previous) : TEXT("new"),
+		GetActivityName(Activity),
+		Actor->NetUpdateFrequency,
+		Frequency);
+
+	//going up, send the state that changed now rather than at the old rate
+	if (Frequency > Actor->NetUpdateFrequency) {
+		Actor->ForceNetUpdate();
+	}
+	Actor->NetUpdateFrequency = Frequency;
+	Activities.Add(Actor, Activity);
+	NumFrequencyChanges++;
+
+}
+
+float UShooterServerGovernor::GetNetUpdateFrequency(EShooterNetActivity Activity) const
+{
+
+	switch (Activity) {
+	case EShooterNetActivity::ESNA_Firing: return FiringNetUpdateFrequency;
+	case EShooterNetActivity::ESNA_Moving: return MovingNetUpdateFrequency;
+	}
+	return IdleNetUpdateFrequency;
+
+}
+
+const TCHAR* UShooterServerGovernor::GetActivityName(EShooterNetActivity Activity)
+{
+
+	switch (Activity) {
+	case EShooterNetActivity::ESNA_Idle: return TEXT("Idle");
+	case EShooterNetActivity::ESNA_Moving: return TEXT("Moving");
+	case EShooterNetActivity::ESNA_Firing: return TEXT("Firing");
+	}
+	return TEXT("Unknown");
+
+}
+
+void UShooterServerGovernor::DumpToLog() const
+{
+
+	int32 NumPerActivity[(int32)EShooterNetActivity::ESNA_Max] = {};
+	for (const TPair<TWeakObjectPtr<AActor>, EShooterNetActivity>& Entry : Activities) {
+
+		if (Entry.Key.IsValid()) {
+			NumPerActivity[(int32)Entry.Value]++;
+		}
+
+	}
+
+	UE_LOG(LogShooter, Log, TEXT("Server governor in %s (%s): tick rate %d Hz (configured %d, bounds %d-%d), last average tick %.2f ms, %d tick rate changes, %d net frequency changes"),
+		*GetWorld()->GetName(),
+		GShooterServerGovernorEnabled ? TEXT("on") : TEXT("off"),
+		CurrentTickRate,
+		ConfiguredTickRate,
+		MinTickRate,
+		MaxTickRate,
+		LastAverageTickMs,
+		NumTickRateChanges,
+		NumFrequencyChanges);
+	for (int32 Activity = 0; Activity < (int32)EShooterNetActivity::ESNA_Max; Activity++) {
+
+		UE_LOG(LogShooter, Log, TEXT("  %-7s %d actors at %.0f Hz"),
+			GetActivityName((EShooterNetActivity)Activity),
+			NumPerActivity[Activity],
+			GetNetUpdateFrequency((EShooterNetActivity)Activity));
+
+	}
+
+}
+
+static FAutoConsoleCommandWithWorldAndArgs CmdServerGovernor(
+	TEXT("Shooter.ServerGovernor"),
+	TEXT("Logs the dedicated server's governed tick rate, its last tick cost and actors per net update frequency."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World) {
+
+		if (UShooterServerGovernor* Governor = World ? World->GetSubsystem<UShooterServerGovernor>() : nullptr) {
+			Governor->DumpToLog();
+		}
+
+	}));
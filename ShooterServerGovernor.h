@@ -0,0 +1,119 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ShooterServerGovernor.generated.h"
+
+enum class EShooterNetActivity : uint8 {
+	ESNA_Idle, // standing character, resting pickup
+	ESNA_Moving,
+	ESNA_Firing,
+
+	ESNA_Max
+};
+
+/**
+ * Dedicated server load governor. Times each frame from world tick start to the end of the frame,
+ * replication included, and once per EvaluateSeconds moves the net
+ * driver's NetServerMaxTickRate one TickRateStep down when the average tick takes more than
+ * HighLoadFraction of the frame, or one step up when it would still fit in LowLoadFraction of the
+ * faster frame, always within MinTickRate..MaxTickRate. Characters and items get a NetUpdateFrequency
+ * for what they are doing: firing, moving or idle, equipped weapons follow their owner and resting
+ * pickups drop to the idle rate. Every change is logged to LogShooter (actors at Verbose).
+ *
+ * Bounds and rates live in DefaultGame.ini:
+ * [/Script/TheLastShooter.ShooterServerGovernor]
+ * MinTickRate=20
+ * MaxTickRate=60
+ */
+UCLASS(Config = Game)
+class THELASTSHOOTER_API UShooterServerGovernor : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UShooterServerGovernor();
+
+	static UShooterServerGovernor* Get(const UObject* WorldContextObject);
+
+	//dedicated server game worlds only
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	void DumpToLog() const;
+
+	static const TCHAR* GetActivityName(EShooterNetActivity Activity);
+
+private:
+	void OnWorldTickStart(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+	void OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+	void OnEndFrame();
+
+	void UpdateTickRate(float AverageTickMs);
+	void UpdateNetFrequencies();
+
+	//back to the tick rate the net driver had before the governor touched it
+	void RestoreTickRate();
+
+	void SetNetActivity(AActor* Actor, EShooterNetActivity Activity);
+
+	float GetNetUpdateFrequency(EShooterNetActivity Activity) const;
+
+	UPROPERTY(Config)
+	int32 MinTickRate;
+
+	UPROPERTY(Config)
+	int32 MaxTickRate;
+
+	UPROPERTY(Config)
+	int32 TickRateStep;
+
+	//average tick above this fraction of the frame at the current rate steps the rate down
+	UPROPERTY(Config)
+	float HighLoadFraction;
+
+	//average tick below this fraction of the frame at the next rate up steps the rate up
+	UPROPERTY(Config)
+	float LowLoadFraction;
+
+	UPROPERTY(Config)
+	float EvaluateSeconds;
+
+	//seconds between net update frequency passes over the characters and items
+	UPROPERTY(Config)
+	float NetFrequencySeconds;
+
+	UPROPERTY(Config)
+	float FiringNetUpdateFrequency;
+
+	UPROPERTY(Config)
+	float MovingNetUpdateFrequency;
+
+	UPROPERTY(Config)
+	float IdleNetUpdateFrequency;
+
+	//activity each actor was last given, only changes are applied and logged
+	TMap<TWeakObjectPtr<AActor>, EShooterNetActivity> Activities;
+
+	FDelegateHandle TickStartHandle;
+	FDelegateHandle PostActorTickHandle;
+	FDelegateHandle EndFrameHandle;
+
+	uint64 TickStartCycles = 0;
+	double TickCostMs = 0.0;
+	int32 NumTicks = 0;
+	float SecondsSinceEvaluate = 0.f;
+	float SecondsSinceNetFrequency = 0.f;
+
+	//NetServerMaxTickRate from the net driver's config, 0 until the governor first changes it
+	int32 ConfiguredTickRate = 0;
+	int32 CurrentTickRate = 0;
+	float LastAverageTickMs = 0.f;
+
+	int32 NumTickRateChanges = 0;
+	int32 NumFrequencyChanges = 0;
+};
@@ -0,0 +1,305 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterStressTestGameMode.h"
+#include "TheLastShooter.h"
+#include "ShooterChar.h"
+#include "ShooterBotController.h"
+#include "ShooterPerf.h"
+#include "ShooterCrowdSubsystem.h"
+#include "Weapon.h"
+#include "NavigationSystem.h"
+#include "EngineUtils.h"
+#include "GameFramework/PlayerStart.h"
+#include "RenderCore.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "HAL/PlatformMemory.h"
+#include "HAL/IConsoleManager.h"
+
+//sets an int cvar and returns what it was, 0 when it doesn't exist
+static int32 SetCVarInt(const TCHAR* Name, int32 Value)
+{
+
+	IConsoleVariable* CVar = IConsoleManager::Get().FindConsoleVariable(Name);
+	if (CVar == nullptr) {
+		return 0;
+	}
+
+	const int32 Saved = CVar->GetInt();
+	CVar->Set(Value, ECVF_SetByConsole);
+	return Saved;
+
+}
+
+AShooterStressTestGameMode::AShooterStressTestGameMode() :
+	NumBots(100),
+	NumLooseWeapons(50),
+	SpawnRadius(5000.f),
+	WarmUpSeconds(5.f),
+	TestSeconds(60.f),
+	GameThreadP95BudgetMs(16.6f),
+	GameThreadP99BudgetMs(33.3f),
+	SpawnOrigin(FVector::ZeroVector),
+	SavedCrowdEnabled(1),
+	SavedMovementLOD(1),
+	NumSpawnedBots(0),
+	FrameIndex(0),
+	PassIndex(0),
+	ElapsedSeconds(0.f),
+	PassSeconds(0.f),
+	bNoLocalView(false),
+	bCompareMovementLOD(false),
+	bFinished(false)
+{
+
+	PrimaryActorTick.bCanEverTick = true;
+	BotClass = AShooterChar::StaticClass();
+
+}
+
+void AShooterStressTestGameMode::InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage)
+{
+
+	Super::InitGame(MapName, Options, ErrorMessage);
+
+	const TCHAR* CommandLine = FCommandLine::Get();
+	FParse::Value(CommandLine, TEXT("ShooterBots="), NumBots);
+	FParse::Value(CommandLine, TEXT("ShooterStressSeconds="), TestSeconds);
+	FParse::Value(CommandLine, TEXT("ShooterStressP95Ms="), GameThreadP95BudgetMs);
+	FParse::Value(CommandLine, TEXT("ShooterStressP99Ms="), GameThreadP99BudgetMs);
+	NumBots = FMath::Clamp(NumBots, 1, 1000);
+	bCompareMovementLOD = FParse::Param(CommandLine, TEXT("ShooterCompareMovementLOD"));
+	bNoLocalView = bCompareMovementLOD || FParse::Param(CommandLine, TEXT("ShooterNoLocalView"));
+
+	FString BotClassPath;
+	if (FParse::Value(CommandLine, TEXT("ShooterBotClass="), BotClassPath)) {
+
+		if (UClass* LoadedClass = LoadClass<AShooterChar>(nullptr, *BotClassPath)) {
+			BotClass = LoadedClass;
+		}
+		else {
+			UE_LOG(LogShooter, Error, TEXT("Stress test: can't load bot class %s"), *BotClassPath);
+		}
+
+	}
+
+	if (!FParse::Value(CommandLine, TEXT("ShooterStressCsv="), CsvPath)) {
+		CsvPath = FPaths::ProfilingDir() / TEXT("ShooterStress.csv");
+	}
+
+}
+
+void AShooterStressTestGameMode::BeginPlay()
+{
+
+	Super::BeginPlay();
+
+	CsvRows = TEXT("Frame,Pass,Seconds,DeltaMs,GameThreadMs,Traces,Actors,Bots,ReducedMovement,UsedPhysicalMB\n");
+	JudgedGameThreadMs.Reserve(FMath::CeilToInt(TestSeconds * 120.f));
+
+	if (bNoLocalView) {
+
+		if (UShooterCrowdSubsystem* Crowd = UShooterCrowdSubsystem::Get(this)) {
+			Crowd->SetIgnorePlayerViews(true);
+		}
+
+	}
+
+	//bots stay full actors, only their movement LOD differs between the passes
+	if (bCompareMovementLOD) {
+
+		FullMovementGameThreadMs.Reserve(FMath::CeilToInt(TestSeconds * 120.f));
+		SavedCrowdEnabled = SetCVarInt(TEXT("Shooter.Crowd.Enabled"), 0);
+		SavedMovementLOD = SetCVarInt(TEXT("Shooter.Crowd.MovementLOD"), 1);
+
+	}
+
+	SpawnBots();
+	SpawnLooseWeapons();
+
+	UE_LOG(LogShooter, Log, TEXT("Stress test: %d bots, %d loose weapons, %.0fs%s%s"),
+		NumSpawnedBots,
+		NumLooseWeapons,
+		TestSeconds,
+		bNoLocalView ? TEXT(", no local view") : TEXT(""),
+		bCompareMovementLOD ? TEXT(", movement LOD comparison") : TEXT(""));
+
+}
+
+bool AShooterStressTestGameMode::FindSpawnLocation(FVector& OutLocation)
+{
+
+	UNavigationSystemV1* NavSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	FNavLocation NavLocation;
+	if (NavSystem && NavSystem->GetRandomReachablePointInRadius(SpawnOrigin, SpawnRadius, NavLocation)) {
+
+		OutLocation = NavLocation.Location + FVector(0.f, 0.f, 100.f);
+		return true;
+
+	}
+	return false;
+
+}
+
+void AShooterStressTestGameMode::SpawnBots()
+{
+
+	SpawnOrigin = FVector::ZeroVector;
+	for (TActorIterator<APlayerStart> It(GetWorld()); It; ++It) {
+		SpawnOrigin = It->GetActorLocation();
+		break;
+	}
+
+	for (int32 i = 0; i < NumBots; i++) {
+
+		FVector Location;
+		if (!FindSpawnLocation(Location)) {
+			//no navmesh, lay them out on a grid
+			Location = SpawnOrigin + FVector((i % 20) * 200.f, (i / 20) * 200.f, 100.f);
+		}
+
+		const FTransform SpawnTransform{ FRotator(0.f, FMath::FRandRange(-180.f, 180.f), 0.f), Location };
+		AShooterChar* Bot = GetWorld()->SpawnActorDeferred<AShooterChar>(BotClass, SpawnTransform, nullptr, nullptr,
+			ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn);
+		if (Bot == nullptr) {
+			continue;
+		}
+
+		Bot->AIControllerClass = AShooterBotController::StaticClass();
+		Bot->AutoPossessAI = EAutoPossessAI::Spawned;
+		Bot->FinishSpawning(SpawnTransform);
+
+		if (AShooterBotController* BotController = Cast<AShooterBotController>(Bot->GetController())) {
+			BotController->SetRandomSeed(i);
+		}
+		NumSpawnedBots++;
+
+	}
+
+}
+
+void AShooterStressTestGameMode::SpawnLooseWeapons()
+{
+
+	if (LooseWeaponClass == nullptr) {
+		return;
+	}
+
+	for (int32 i = 0; i < NumLooseWeapons; i++) {
+
+		FVector Location;
+		if (!FindSpawnLocation(Location)) {
+			Location = SpawnOrigin + FVector((i % 20) * 300.f, -(i / 20) * 300.f - 300.f, 50.f);
+		}
+		GetWorld()->SpawnActor<AWeapon>(LooseWeaponClass, Location, FRotator::ZeroRotator);
+
+	}
+
+}
+
+void AShooterStressTestGameMode::Tick(float DeltaSeconds)
+{
+
+	Super::Tick(DeltaSeconds);
+
+	if (bFinished) {
+		return;
+	}
+
+	ElapsedSeconds += DeltaSeconds;
+	PassSeconds += DeltaSeconds;
+	RecordFrame(DeltaSeconds);
+
+	if (PassSeconds >= WarmUpSeconds + TestSeconds) {
+
+		if (bCompareMovementLOD && PassIndex == 0) {
+			StartFullMovementPass();
+		}
+		else {
+			FinishTest();
+		}
+
+	}
+
+}
+
+void AShooterStressTestGameMode::RecordFrame(float DeltaSeconds)
+{
+
+	//GGameThreadTime and the frame counters both describe the previous, completed frame
+	const float GameThreadMs = FPlatformTime::ToMilliseconds(GGameThreadTime);
+	const FShooterFrameCounts& Counts = FShooterFrameCounters::Get().GetLastFrame();
+	const float UsedPhysicalMB = FPlatformMemory::GetStats().UsedPhysical / (1024.f * 1024.f);
+	const UShooterCrowdSubsystem* Crowd = GetWorld()->GetSubsystem<UShooterCrowdSubsystem>();
+
+	CsvRows += FString::Printf(TEXT("%d,%d,%.3f,%.3f,%.3f,%d,%d,%d,%d,%.1f\n"),
+		FrameIndex++,
+		PassIndex,
+		ElapsedSeconds,
+		DeltaSeconds * 1000.f,
+		GameThreadMs,
+		Counts.Traces,
+		GetWorld()->GetActorCount(),
+		NumSpawnedBots,
+		Crowd ? Crowd->GetNumReducedMovement() : 0,
+		UsedPhysicalMB);
+
+	if (PassSeconds > WarmUpSeconds) {
+		(PassIndex == 0 ? JudgedGameThreadMs : FullMovementGameThreadMs).Add(GameThreadMs);
+	}
+
+}
+
+void AShooterStressTestGameMode::StartFullMovementPass()
+{
+
+	//bots on reduced movement go back to full on the next crowd update, the new warm-up covers the switch
+	PassIndex = 1;
+	PassSeconds = 0.f;
+	SetCVarInt(TEXT("Shooter.Crowd.MovementLOD"), 0);
+	UE_LOG(LogShooter, Log, TEXT("Stress test: movement LOD pass done, running again with full movement"));
+
+}
+
+void AShooterStressTestGameMode::FinishTest()
+{
+
+	bFinished = true;
+
+	if (!FFileHelper::SaveStringToFile(CsvRows, *CsvPath)) {
+		UE_LOG(LogShooter, Error, TEXT("Stress test: can't write %s"), *CsvPath);
+	}
+
+	const FShooterPercentiles GameThread = FShooterPercentiles::Compute(JudgedGameThreadMs);
+	const bool bPassed = GameThread.Num > 0 &&
+		GameThread.P95 <= GameThreadP95BudgetMs &&
+		GameThread.P99 <= GameThreadP99BudgetMs;
+
+	UE_LOG(LogShooter, Display, TEXT("Stress test %s: %d bots, game thread %s (budget p95 %.2fms p99 %.2fms), csv %s"),
+		bPassed ? TEXT("PASSED") : TEXT("FAILED"),
+		NumSpawnedBots,
+		*GameThread.ToString(),
+		GameThreadP95BudgetMs,
+		GameThreadP99BudgetMs,
+		*CsvPath);
+
+	if (bCompareMovementLOD) {
+
+		const FShooterPercentiles FullMovement = FShooterPercentiles::Compute(FullMovementGameThreadMs);
+		UE_LOG(LogShooter, Display, TEXT("Movement LOD comparison at %d bots: game thread p95 %.2fms with movement LOD, %.2fms with full movement (%+.2fms), full movement %s"),
+			NumSpawnedBots,
+			GameThread.P95,
+			FullMovement.P95,
+			GameThread.P95 - FullMovement.P95,
+			*FullMovement.ToString());
+
+		SetCVarInt(TEXT("Shooter.Crowd.Enabled"), SavedCrowdEnabled);
+		SetCVarInt(TEXT("Shooter.Crowd.MovementLOD"), SavedMovementLOD);
+
+	}
+
+	FPlatformMisc::RequestExitWithStatus(false, bPassed ? 0 : 1);
+
+}
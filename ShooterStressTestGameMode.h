@@ -0,0 +1,106 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "TheLastShooterGameModeBase.h"
+#include "ShooterStressTestGameMode.generated.h"
+
+/**
+ * Headless load test. Spawns NumBots AShooterChar bots driven by AShooterBotController,
+ * records one CSV row per frame and exits with 0 (pass) or 1 (fail) against the frame budgets.
+ *
+ * UE4Editor-Cmd TheLastShooter <Map>?game=/Script/TheLastShooter.ShooterStressTestGameMode
+ *     -game -nullrhi -nosound -unattended -ShooterBots=300
+ *
+ * Optional: -ShooterBotClass=<class path> -ShooterStressSeconds= -ShooterStressP95Ms= -ShooterStressP99Ms=
+ * -ShooterStressCsv=<file> (defaults to Saved/Profiling/ShooterStress.csv)
+ *
+ * -game still spawns a local player at the PlayerStart the bots spawn around, its view keeps every bot
+ * inside Shooter.Crowd.MovementLODRadius on full movement. -ShooterNoLocalView makes the crowd ignore
+ * player views, so every bot counts as far.
+ *
+ * Movement LOD comparison: -ShooterBots=200 -ShooterCompareMovementLOD runs the warm-up and test window
+ * twice with no local view and Shooter.Crowd.Enabled 0, first with Shooter.Crowd.MovementLOD 1 and then 0,
+ * and logs both game thread P95s. The Pass column of the CSV tells the runs apart, the verdict is on the first.
+ */
+UCLASS()
+class THELASTSHOOTER_API AShooterStressTestGameMode : public ATheLastShooterGameModeBase
+{
+	GENERATED_BODY()
+
+public:
+	AShooterStressTestGameMode();
+
+	virtual void InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage) override;
+
+	virtual void Tick(float DeltaSeconds) override;
+
+protected:
+	virtual void BeginPlay() override;
+
+	void SpawnBots();
+	void SpawnLooseWeapons();
+
+	void RecordFrame(float DeltaSeconds);
+
+	//writes the CSV, logs the verdict and quits
+	void FinishTest();
+
+	//second run of a movement LOD comparison, everybody on full movement
+	void StartFullMovementPass();
+
+	bool FindSpawnLocation(FVector& OutLocation);
+
+private:
+	UPROPERTY(EditDefaultsOnly, Category = StressTest, meta = (AllowPrivateAccess = "true"))
+	TSubclassOf<class AShooterChar> BotClass;
+
+	UPROPERTY(EditDefaultsOnly, Category = StressTest, meta = (AllowPrivateAccess = "true"))
+	TSubclassOf<class AWeapon> LooseWeaponClass;
+
+	UPROPERTY(EditDefaultsOnly, Category = StressTest, meta = (AllowPrivateAccess = "true", ClampMin = "1", ClampMax = "1000"))
+	int32 NumBots;
+
+	//weapons lying around for bots to swap to
+	UPROPERTY(EditDefaultsOnly, Category = StressTest, meta = (AllowPrivateAccess = "true"))
+	int32 NumLooseWeapons;
+
+	UPROPERTY(EditDefaultsOnly, Category = StressTest, meta = (AllowPrivateAccess = "true"))
+	float SpawnRadius;
+
+	//frames in this window after spawning are recorded but not judged
+	UPROPERTY(EditDefaultsOnly, Category = StressTest, meta = (AllowPrivateAccess = "true"))
+	float WarmUpSeconds;
+
+	UPROPERTY(EditDefaultsOnly, Category = StressTest, meta = (AllowPrivateAccess = "true"))
+	float TestSeconds;
+
+	UPROPERTY(EditDefaultsOnly, Category = StressTest, meta = (AllowPrivateAccess = "true"))
+	float GameThreadP95BudgetMs;
+
+	UPROPERTY(EditDefaultsOnly, Category = StressTest, meta = (AllowPrivateAccess = "true"))
+	float GameThreadP99BudgetMs;
+
+	FVector SpawnOrigin;
+
+	FString CsvPath;
+	FString CsvRows;
+	TArray<float> JudgedGameThreadMs;
+	//judged frames of the full movement pass when comparing
+	TArray<float> FullMovementGameThreadMs;
+
+	//cvars the comparison overrides, put back when the test ends
+	int32 SavedCrowdEnabled;
+	int32 SavedMovementLOD;
+
+	int32 NumSpawnedBots;
+	int32 FrameIndex;
+	int32 PassIndex;
+	float ElapsedSeconds;
+	//time since the current pass started, each pass has its own warm-up
+	float PassSeconds;
+	bool bNoLocalView;
+	bool bCompareMovementLOD;
+	bool bFinished;
+};
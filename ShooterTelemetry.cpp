@@ -0,0 +1,455 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterTelemetry.h"
+#include "TheLastShooter.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/Pawn.h"
+#include "HAL/FileManager.h"
+#include "HAL/Runnable.h"
+#include "HAL/RunnableThread.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/Compression.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+
+static int32 GShooterTelemetryMaxFileMB = 64;
+static FAutoConsoleVariableRef CVarShooterTelemetryMaxFileMB(
+	TEXT("Shooter.Telemetry.MaxFileMB"),
+	GShooterTelemetryMaxFileMB,
+	TEXT("Telemetry files are rotated once they would grow past this size."));
+
+//records per compressed chunk, 64 KB before compression
+static const int32 ChunkRecords = 2048;
+
+//partial chunks are written after this long so a crash loses little
+static const double MaxChunkAgeSeconds = 1.0;
+
+/** Ring buffer with one producer (the owning thread) and one consumer (the writer) */
+class FShooterTelemetryThreadBuffer
+{
+public:
+	static constexpr uint32 Capacity = 8192;
+	static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+	FShooterTelemetryRecord Records[Capacity];
+
+	//written by the producer only
+	std::atomic<uint32> Head{ 0 };
+	//written by the writer only
+	std::atomic<uint32> Tail{ 0 };
+};
+
+class FShooterTelemetryWriter : public FRunnable
+{
+public:
+	FShooterTelemetryWriter(FShooterTelemetry& InOwner, const FString& InDirectory) :
+		Owner(InOwner),
+		Directory(InDirectory),
+		FileStem(FDateTime::Now().ToString()),
+		FileIndex(0),
+		LastWriteSeconds(FPlatformTime::Seconds()),
+		WakeEvent(FPlatformProcess::GetSynchEventFromPool()),
+		bStopping(false),
+		NumWritten(0)
+	{
+		Pending.Reserve(ChunkRecords * 2);
+	}
+
+	virtual ~FShooterTelemetryWriter()
+	{
+		FPlatformProcess::ReturnSynchEventToPool(WakeEvent);
+	}
+
+	virtual uint32 Run() override
+	{
+
+		while (!bStopping) {
+
+			WakeEvent->Wait(50);
+			Drain();
+
+		}
+
+		Drain();
+		if (Pending.Num() > 0) {
+			WriteChunk();
+		}
+		if (File) {
+			File->Close();
+			File.Reset();
+		}
+		return 0;
+
+	}
+
+	virtual void Stop() override
+	{
+		bStopping = true;
+		WakeEvent->Trigger();
+	}
+
+	void Wake() { WakeEvent->Trigger(); }
+
+	int64 GetNumWritten() const { return NumWritten.load(std::memory_order_relaxed); }
+
+private:
+	void Drain()
+	{
+
+		{
+			FScopeLock Lock(&Owner.BuffersLock);
+			for (const TUniquePtr<FShooterTelemetryThreadBuffer>& Buffer : Owner.Buffers) {
+
+				const uint32 Head = Buffer->Head.load(std::memory_order_acquire);
+				const uint32 Tail = Buffer->Tail.load(std::memory_order_relaxed);
+				for (uint32 Index = Tail; Index != Head; Index++) {
+					Pending.Add(Buffer->Records[Index & (FShooterTelemetryThreadBuffer::Capacity - 1)]);
+				}
+				Buffer->Tail.store(Head, std::memory_order_release);
+
+			}
+		}
+
+		while (Pending.Num() >= ChunkRecords) {
+			WriteChunk();
+		}
+		if (Pending.Num() > 0 && FPlatformTime::Seconds() - LastWriteSeconds > MaxChunkAgeSeconds) {
+			WriteChunk();
+		}
+
+	}
+
+	void WriteChunk()
+	{
+
+		const int32 NumRecords = FMath::Min(Pending.Num(), ChunkRecords);
+		const int32 UncompressedSize = NumRecords * sizeof(FShooterTelemetryRecord);
+		int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Zlib, UncompressedSize);
+		Compressed.SetNumUninitialized(CompressedSize, false);
+
+		if (FCompression::CompressMemory(NAME_Zlib, Compressed.GetData(), CompressedSize, Pending.GetData(), UncompressedSize)) {
+
+			const int64 MaxFileBytes = (int64)FMath::Max(GShooterTelemetryMaxFileMB, 1) * 1024 * 1024;
+			if (!File || File->Tell() + CompressedSize + 16 > MaxFileBytes) {
+				OpenNextFile();
+			}
+
+			if (File) {
+
+				uint32 ChunkHeader[4] = { FShooterTelemetry::ChunkMagic, (uint32)NumRecords, (uint32)CompressedSize, 0 };
+				File->Serialize(ChunkHeader, sizeof(ChunkHeader));
+				File->Serialize(Compressed.GetData(), CompressedSize);
+				NumWritten.fetch_add(NumRecords, std::memory_order_relaxed);
+
+			}
+
+		}
+
+		Pending.RemoveAt(0, NumRecords, false);
+		LastWriteSeconds = FPlatformTime::Seconds();
+
+	}
+
+	void OpenNextFile()
+	{
+
+		if (File) {
+			File->Close();
+		}
+
+		const FString Path = Directory / FString::Printf(TEXT("Telemetry-%s-%d.stl"), *FileStem, FileIndex++);
+		File.Reset(IFileManager::Get().CreateFileWriter(*Path));
+		if (!File) {
+			UE_LOG(LogShooter, Error, TEXT("Telemetry: can't write %s"), *Path);
+			return;
+		}
+
+		uint32 FileHeader[4] = { FShooterTelemetry::FileMagic, FShooterTelemetry::FileVersion, (uint32)sizeof(FShooterTelemetryRecord), 0 };
+		File->Serialize(FileHeader, sizeof(FileHeader));
+
+	}
+
+	FShooterTelemetry& Owner;
+	FString Directory;
+	FString FileStem;
+	int32 FileIndex;
+	double LastWriteSeconds;
+
+	FEvent* WakeEvent;
+	std::atomic<bool> bStopping;
+	std::atomic<int64> NumWritten;
+
+	TArray<FShooterTelemetryRecord> Pending;
+	TArray<uint8> Compressed;
+	TUniquePtr<FArchive> File;
+};
+
+std::atomic<bool> FShooterTelemetry::bRunning(false);
+
+//this thread's buffer, buffers live as long as the process so the pointer never dangles
+static thread_local FShooterTelemetryThreadBuffer* TlsBuffer = nullptr;
+
+FShooterTelemetry& FShooterTelemetry::Get()
+{
+	static FShooterTelemetry Telemetry;
+	return Telemetry;
+}
+
+FShooterTelemetry::FShooterTelemetry() :
+	NumDropped(0),
+	WriterThread(nullptr)
+{
+}
+
+FShooterTelemetry::~FShooterTelemetry()
+{
+	Stop();
+}
+
+void FShooterTelemetry::Start(const FString& Directory)
+{
+
+	if (Writer) {
+		return;
+	}
+
+	IFileManager::Get().MakeDirectory(*Directory, true);
+	NumDropped = 0;
+	Writer = MakeUnique<FShooterTelemetryWriter>(*this, Directory);
+	WriterThread = FRunnableThread::Create(Writer.Get(), TEXT("ShooterTelemetryWriter"), 0, TPri_BelowNormal);
+	bRunning = true;
+
+	UE_LOG(LogShooter, Log, TEXT("Telemetry: writing to %s"), *Directory);
+
+}
+
+void FShooterTelemetry::Stop()
+{
+
+	if (!Writer) {
+		return;
+	}
+
+	bRunning = false;
+	//Kill stops the writer, which drains and closes the file before returning
+	WriterThread->Kill(true);
+	delete WriterThread;
+	WriterThread = nullptr;
+
+	UE_LOG(LogShooter, Log, TEXT("Telemetry: %lld records written, %lld dropped"), Writer->GetNumWritten(), GetNumDropped());
+	Writer.Reset();
+
+}
+
+int64 FShooterTelemetry::GetNumWritten() const
+{
+	return Writer ? Writer->GetNumWritten() : 0;
+}
+
+FShooterTelemetryThreadBuffer* FShooterTelemetry::RegisterThread()
+{
+
+	FScopeLock Lock(&BuffersLock);
+	Buffers.Add(MakeUnique<FShooterTelemetryThreadBuffer>());
+	TlsBuffer = Buffers.Last().Get();
+	return TlsBuffer;
+
+}
+
+void FShooterTelemetry::Push(EShooterTelemetryEvent Event, const AActor* Actor, const UObject* Target, const FVector& Location, uint8 Detail)
+{
+
+	FShooterTelemetryThreadBuffer* Buffer = TlsBuffer ? TlsBuffer : RegisterThread();
+
+	const uint32 Head = Buffer->Head.load(std::memory_order_relaxed);
+	if (Head - Buffer->Tail.load(std::memory_order_acquire) >= FShooterTelemetryThreadBuffer::Capacity) {
+		//writer fell behind, losing an event beats stalling the game thread
+		NumDropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	const UWorld* World = Actor ? Actor->GetWorld() : nullptr;
+
+	FShooterTelemetryRecord& Record = Buffer->Records[Head & (FShooterTelemetryThreadBuffer::Capacity - 1)];
+	Record.Frame = (uint32)GFrameCounter;
+	Record.WorldSeconds = World ? World->GetTimeSeconds() : 0.f;
+	Record.ActorId = Actor ? Actor->GetUniqueID() : 0;
+	Record.TargetId = Target ? Target->GetUniqueID() : 0;
+	Record.X = Location.X;
+	Record.Y = Location.Y;
+	Record.Z = Location.Z;
+	Record.Event = (uint8)Event;
+	Record.Detail = Detail;
+	Record.Reserved = 0;
+
+	Buffer->Head.store(Head + 1, std::memory_order_release);
+
+}
+
+void FShooterTelemetry::WaitUntilDrained()
+{
+
+	while (Writer) {
+
+		bool bEmpty = true;
+		{
+			FScopeLock Lock(&BuffersLock);
+			for (const TUniquePtr<FShooterTelemetryThreadBuffer>& Buffer : Buffers) {
+				bEmpty &= Buffer->Head.load(std::memory_order_acquire) == Buffer->Tail.load(std::memory_order_acquire);
+			}
+		}
+
+		if (bEmpty) {
+			return;
+		}
+		Writer->Wake();
+		FPlatformProcess::Sleep(0.0005f);
+
+	}
+
+}
+
+bool FShooterTelemetry::ReadFile(const FString& Path, TArray<FShooterTelemetryRecord>& OutRecords)
+{
+
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *Path)) {
+		return false;
+	}
+
+	uint32 FileHeader[4];
+	if (Bytes.Num() < (int32)sizeof(FileHeader)) {
+		return false;
+	}
+	FMemory::Memcpy(FileHeader, Bytes.GetData(), sizeof(FileHeader));
+	if (FileHeader[0] != FileMagic || FileHeader[1] != FileVersion || FileHeader[2] != sizeof(FShooterTelemetryRecord)) {
+		return false;
+	}
+
+	int64 Offset = sizeof(FileHeader);
+	while (Offset < Bytes.Num()) {
+
+		uint32 ChunkHeader[4];
+		if (Offset + (int64)sizeof(ChunkHeader) > Bytes.Num()) {
+			return false;
+		}
+		FMemory::Memcpy(ChunkHeader, Bytes.GetData() + Offset, sizeof(ChunkHeader));
+		Offset += sizeof(ChunkHeader);
+
+		const int32 NumRecords = (int32)ChunkHeader[1];
+		const int32 CompressedSize = (int32)ChunkHeader[2];
+		//the writer never puts more than ChunkRecords in a chunk, anything else is a damaged header asking for memory
+		if (ChunkHeader[0] != ChunkMagic || NumRecords < 0 || NumRecords > ChunkRecords || CompressedSize < 0 || Offset + CompressedSize > Bytes.Num()) {
+			//truncated by a crash, the records before it are still good
+			return false;
+		}
+
+		const int32 First = OutRecords.Num();
+		OutRecords.AddUninitialized(NumRecords);
+		if (!FCompression::UncompressMemory(NAME_Zlib,
+			OutRecords.GetData() + First,
+			NumRecords * sizeof(FShooterTelemetryRecord),
+			Bytes.GetData() + Offset,
+			CompressedSize)) {
+
+			OutRecords.SetNum(First);
+			return false;
+
+		}
+		Offset += CompressedSize;
+
+	}
+
+	return true;
+
+}
+
+const TCHAR* FShooterTelemetry::GetEventName(EShooterTelemetryEvent Event)
+{
+
+	switch (Event) {
+	case EShooterTelemetryEvent::ESTE_Shot: return TEXT("Shot");
+	case EShooterTelemetryEvent::ESTE_Hit: return TEXT("Hit");
+	case EShooterTelemetryEvent::ESTE_Pickup: return TEXT("Pickup");
+	case EShooterTelemetryEvent::ESTE_Drop: return TEXT("Drop");
+	case EShooterTelemetryEvent::ESTE_Swap: return TEXT("Swap");
+	case EShooterTelemetryEvent::ESTE_Impact: return TEXT("Impact");
+	}
+	return TEXT("Unknown");
+
+}
+
+void UShooterTelemetrySubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+
+	Super::Initialize(Collection);
+
+	if (FParse::Param(FCommandLine::Get(), TEXT("ShooterTelemetry")) && !FShooterTelemetry::IsRunning()) {
+		FShooterTelemetry::Get().Start(FPaths::ProjectSavedDir() / TEXT("Telemetry"));
+		bStartedTelemetry = true;
+	}
+
+}
+
+void UShooterTelemetrySubsystem::Deinitialize()
+{
+
+	if (bStartedTelemetry) {
+		FShooterTelemetry::Get().Stop();
+		bStartedTelemetry = false;
+	}
+	Super::Deinitialize();
+
+}
+
+static FAutoConsoleCommandWithWorldAndArgs CmdBenchTelemetry(
+	TEXT("Shooter.BenchTelemetry"),
+	TEXT("Shooter.BenchTelemetry [Events=100000]: game thread cost of recording a telemetry event, budget 1 us."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World) {
+
+		const int32 NumEvents = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 100000;
+		const double BudgetNs = 1000.0;
+
+		FShooterTelemetry& Telemetry = FShooterTelemetry::Get();
+		const bool bWasRunning = FShooterTelemetry::IsRunning();
+		if (!bWasRunning) {
+			Telemetry.Start(FPaths::ProjectSavedDir() / TEXT("Telemetry") / TEXT("Bench"));
+		}
+
+		APlayerController* PlayerController = World ? World->GetFirstPlayerController() : nullptr;
+		const AActor* Actor = PlayerController ? PlayerController->GetPawn() : nullptr;
+		const int64 DroppedBefore = Telemetry.GetNumDropped();
+
+		//batches of half a buffer, the writer empties it between batches outside the timing
+		const int32 BatchSize = FShooterTelemetryThreadBuffer::Capacity / 2;
+		uint64 Cycles = 0;
+		for (int32 Done = 0; Done < NumEvents; Done += BatchSize) {
+
+			Telemetry.WaitUntilDrained();
+
+			const int32 Count = FMath::Min(BatchSize, NumEvents - Done);
+			const uint64 StartCycles = FPlatformTime::Cycles64();
+			for (int32 i = 0; i < Count; i++) {
+				FShooterTelemetry::Record(EShooterTelemetryEvent::ESTE_Shot, Actor, Actor, FVector((float)i, 0.f, 0.f));
+			}
+			Cycles += FPlatformTime::Cycles64() - StartCycles;
+
+		}
+
+		const double NsPerEvent = FPlatformTime::ToMilliseconds64(Cycles) * 1000000.0 / FMath::Max(NumEvents, 1);
+		UE_LOG(LogShooter, Display, TEXT("Telemetry bench: %d events, %.1f ns per event on the game thread (budget %.0f ns) %s, %lld dropped"),
+			NumEvents,
+			NsPerEvent,
+			BudgetNs,
+			NsPerEvent < BudgetNs ? TEXT("PASS") : TEXT("FAIL"),
+			Telemetry.GetNumDropped() - DroppedBefore);
+
+		if (!bWasRunning) {
+			Telemetry.Stop();
+		}
+
+	}));
@@ -0,0 +1,115 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include <atomic>
+#include "ShooterTelemetry.generated.h"
+
+class FShooterTelemetryThreadBuffer;
+class FShooterTelemetryWriter;
+
+enum class EShooterTelemetryEvent : uint8 {
+	ESTE_Shot, // FireWeapon, Target = weapon, Location = muzzle
+	ESTE_Hit, // GetBeamEndLocation, Target = character hit, Detail = EShooterBodyPart, Location = impact
+	ESTE_Pickup, // SelectButtonPressed, Target = item picked up
+	ESTE_Drop, // DropWeapon, Target = weapon dropped
+	ESTE_Swap, // SwapWeapon, Target = weapon equipped
+	ESTE_Impact, // GetBeamEndLocation, shot stopped by the world, Target = actor hit, Location = impact
+
+	ESTE_Max
+};
+
+/** One gameplay event, written to disk as is (32 bytes, little endian) */
+struct FShooterTelemetryRecord
+{
+	uint32 Frame; // GFrameCounter, low 32 bits
+	float WorldSeconds; // UWorld::GetTimeSeconds
+	uint32 ActorId; // UObject unique id of the character, stable within one run only
+	uint32 TargetId; // unique id of the weapon, item or actor hit, 0 = none
+	float X, Y, Z;
+	uint8 Event; // EShooterTelemetryEvent
+	uint8 Detail;
+	uint16 Reserved;
+};
+static_assert(sizeof(FShooterTelemetryRecord) == 32, "telemetry files depend on the record size");
+
+/**
+ * Binary gameplay telemetry. Record() copies a fixed-size record into a single-producer ring
+ * buffer owned by the calling thread, no locks and no allocation after a thread's first event.
+ * A writer thread drains the buffers, compresses them in chunks and streams them to
+ * Saved/Telemetry/Telemetry-<time>-<n>.stl, starting a new file past Shooter.Telemetry.MaxFileMB.
+ *
+ * File: uint32 magic 'STL1', uint32 version, uint32 record size, uint32 reserved, then chunks of
+ * uint32 magic 'STCK', uint32 record count, uint32 compressed size, uint32 reserved, followed by
+ * that many zlib compressed bytes holding the records back to back.
+ *
+ * Enabled with -ShooterTelemetry. Read files with -run=ShooterTelemetryReader.
+ */
+class THELASTSHOOTER_API FShooterTelemetry
+{
+public:
+	static constexpr uint32 FileMagic = 0x314C5453; // 'STL1'
+	static constexpr uint32 ChunkMagic = 0x4B435453; // 'STCK'
+	static constexpr uint32 FileVersion = 1;
+
+	static FShooterTelemetry& Get();
+
+	void Start(const FString& Directory);
+	//drains what is left, flushes and closes the file
+	void Stop();
+
+	FORCEINLINE static bool IsRunning() { return bRunning.load(std::memory_order_relaxed); }
+
+	FORCEINLINE static void Record(EShooterTelemetryEvent Event, const AActor* Actor, const UObject* Target, const FVector& Location, uint8 Detail = 0)
+	{
+		if (IsRunning()) {
+			Get().Push(Event, Actor, Target, Location, Detail);
+		}
+	}
+
+	int64 GetNumDropped() const { return NumDropped.load(std::memory_order_relaxed); }
+	int64 GetNumWritten() const;
+
+	//wakes the writer and waits until every buffer is empty, for benchmarks
+	void WaitUntilDrained();
+
+	//whole file, false on a bad header or chunk
+	static bool ReadFile(const FString& Path, TArray<FShooterTelemetryRecord>& OutRecords);
+
+	static const TCHAR* GetEventName(EShooterTelemetryEvent Event);
+
+private:
+	FShooterTelemetry();
+	~FShooterTelemetry();
+
+	void Push(EShooterTelemetryEvent Event, const AActor* Actor, const UObject* Target, const FVector& Location, uint8 Detail);
+
+	FShooterTelemetryThreadBuffer* RegisterThread();
+
+	static std::atomic<bool> bRunning;
+	std::atomic<int64> NumDropped;
+
+	FCriticalSection BuffersLock;
+	TArray<TUniquePtr<FShooterTelemetryThreadBuffer>> Buffers;
+
+	TUniquePtr<FShooterTelemetryWriter> Writer;
+	FRunnableThread* WriterThread;
+
+	friend class FShooterTelemetryWriter;
+};
+
+/** Starts telemetry with the game instance when -ShooterTelemetry is on the command line */
+UCLASS()
+class THELASTSHOOTER_API UShooterTelemetrySubsystem : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+private:
+	bool bStartedTelemetry = false;
+};
@@ -0,0 +1,106 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterTelemetryReaderCommandlet.h"
+#include "ShooterTelemetry.h"
+#include "TheLastShooter.h"
+#include "Misc/FileHelper.h"
+
+UShooterTelemetryReaderCommandlet::UShooterTelemetryReaderCommandlet()
+{
+
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+
+}
+
+int32 UShooterTelemetryReaderCommandlet::Main(const FString& Params)
+{
+
+	FString FilePath;
+	if (!FParse::Value(*Params, TEXT("File="), FilePath)) {
+		UE_LOG(LogShooter, Error, TEXT("Usage: -run=ShooterTelemetryReader -File=<file.stl> [-Csv=<out.csv>]"));
+		return 1;
+	}
+
+	TArray<FShooterTelemetryRecord> Records;
+	const bool bComplete = FShooterTelemetry::ReadFile(FilePath, Records);
+	if (!bComplete && Records.Num() == 0) {
+		UE_LOG(LogShooter, Error, TEXT("%s is not a telemetry file"), *FilePath);
+		return 1;
+	}
+	UE_CLOG(!bComplete, LogShooter, Warning, TEXT("%s is truncated, reporting the %d records before the damage"), *FilePath, Records.Num());
+
+	int32 EventCounts[(int32)EShooterTelemetryEvent::ESTE_Max] = {};
+	TMap<uint32, TPair<int32, int32>> ShotsAndHitsPerActor;
+	float FirstSeconds = MAX_flt;
+	float LastSeconds = 0.f;
+
+	for (const FShooterTelemetryRecord& Record : Records) {
+
+		if (Record.Event < (uint8)EShooterTelemetryEvent::ESTE_Max) {
+			EventCounts[Record.Event]++;
+		}
+		FirstSeconds = FMath::Min(FirstSeconds, Record.WorldSeconds);
+		LastSeconds = FMath::Max(LastSeconds, Record.WorldSeconds);
+
+		TPair<int32, int32>& ShotsAndHits = ShotsAndHitsPerActor.FindOrAdd(Record.ActorId);
+		if (Record.Event == (uint8)EShooterTelemetryEvent::ESTE_Shot) {
+			ShotsAndHits.Key++;
+		}
+		else if (Record.Event == (uint8)EShooterTelemetryEvent::ESTE_Hit) {
+			ShotsAndHits.Value++;
+		}
+
+	}
+
+	UE_LOG(LogShooter, Display, TEXT("%s: %d records, world time %.2f s to %.2f s"),
+		*FilePath,
+		Records.Num(),
+		Records.Num() > 0 ? FirstSeconds : 0.f,
+		LastSeconds);
+	for (int32 Event = 0; Event < (int32)EShooterTelemetryEvent::ESTE_Max; Event++) {
+		UE_LOG(LogShooter, Display, TEXT("  %-8s %d"), FShooterTelemetry::GetEventName((EShooterTelemetryEvent)Event), EventCounts[Event]);
+	}
+	for (const auto& Pair : ShotsAndHitsPerActor) {
+
+		UE_LOG(LogShooter, Display, TEXT("  actor %u: %d shots, %d character hits (%.1f%%)"),
+			Pair.Key,
+			Pair.Value.Key,
+			Pair.Value.Value,
+			Pair.Value.Key > 0 ? 100.f * Pair.Value.Value / Pair.Value.Key : 0.f);
+
+	}
+
+	FString CsvPath;
+	if (FParse::Value(*Params, TEXT("Csv="), CsvPath)) {
+
+		FString Csv = TEXT("Frame,WorldSeconds,Event,ActorId,TargetId,X,Y,Z,Detail\n");
+		for (const FShooterTelemetryRecord& Record : Records) {
+
+			Csv += FString::Printf(TEXT("%u,%.4f,%s,%u,%u,%.1f,%.1f,%.1f,%u\n"),
+				Record.Frame,
+				Record.WorldSeconds,
+				FShooterTelemetry::GetEventName((EShooterTelemetryEvent)Record.Event),
+				Record.ActorId,
+				Record.TargetId,
+				Record.X,
+				Record.Y,
+				Record.Z,
+				(uint32)Record.Detail);
+
+		}
+
+		if (!FFileHelper::SaveStringToFile(Csv, *CsvPath)) {
+			UE_LOG(LogShooter, Error, TEXT("Can't write %s"), *CsvPath);
+			return 1;
+		}
+		UE_LOG(LogShooter, Display, TEXT("Wrote %s"), *CsvPath);
+
+	}
+
+	return 0;
+
+}
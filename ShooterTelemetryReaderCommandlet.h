@@ -0,0 +1,25 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "ShooterTelemetryReaderCommandlet.generated.h"
+
+/**
+ * Offline reader for telemetry files (see FShooterTelemetry for the format).
+ *
+ *   -run=ShooterTelemetryReader -File=<file.stl> [-Csv=<out.csv>]
+ *
+ * Logs event counts, the time span and shots/hits per actor, optionally dumps every record as CSV.
+ */
+UCLASS()
+class UShooterTelemetryReaderCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UShooterTelemetryReaderCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
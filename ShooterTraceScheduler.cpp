@@ -0,0 +1,225 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterTraceScheduler.h"
+#include "TheLastShooter.h"
+#include "ShooterPerf.h"
+#include "Engine/World.h"
+#include "Engine/Engine.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Traces Deferred"), STAT_ShooterTracesDeferred, STATGROUP_TheLastShooter);
+
+static int32 GShooterTraceBudgetPerFrame = 256;
+static FAutoConsoleVariableRef CVarShooterTraceBudgetPerFrame(
+	TEXT("Shooter.Trace.BudgetPerFrame"),
+	GShooterTraceBudgetPerFrame,
+	TEXT("Gameplay line traces allowed per frame and world, 0 = no limit. Shots are never deferred."));
+
+static float GShooterTraceItemFocusReserve = 0.25f;
+static FAutoConsoleVariableRef CVarShooterTraceItemFocusReserve(
+	TEXT("Shooter.Trace.ItemFocusReserve"),
+	GShooterTraceItemFocusReserve,
+	TEXT("Fraction of the trace budget item focus may not use, kept for shots."));
+
+static float GShooterTraceReuseTolerance = 16.f;
+static FAutoConsoleVariableRef CVarShooterTraceReuseTolerance(
+	TEXT("Shooter.Trace.ReuseTolerance"),
+	GShooterTraceReuseTolerance,
+	TEXT("Units the start and the end of a deferred ray may be off the last traced one and still reuse its result."));
+
+static int32 GShooterTraceLegacyChannels = 0;
+static FAutoConsoleVariableRef CVarShooterTraceLegacyChannels(
+	TEXT("Shooter.Trace.LegacyChannels"),
+	GShooterTraceLegacyChannels,
+	TEXT("1 = shots and item focus all trace ECC_Visibility over the full range, to compare query cost with the dedicated channels. Item boxes pick it up on their next state change."));
+
+//cache entries nobody asked for in this many frames are dropped
+static const uint64 CacheExpiryFrames = 300;
+
+UShooterTraceScheduler* UShooterTraceScheduler::Get(const UObject* WorldContextObject)
+{
+
+	UWorld* World = GEngine ? GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::LogAndReturnNull) : nullptr;
+	return World ? World->GetSubsystem<UShooterTraceScheduler>() : nullptr;
+
+}
+
+bool UShooterTraceScheduler::CanRun(EShooterTracePriority Priority) const
+{
+
+	if (GShooterTraceBudgetPerFrame <= 0) {
+		return true;
+	}
+
+	switch (Priority) {
+	case EShooterTracePriority::ESTP_Shot:
+		return true;
+	case EShooterTracePriority::ESTP_ItemFocus:
+		return TracesThisFrame < FMath::FloorToInt(GShooterTraceBudgetPerFrame * (1.f - GShooterTraceItemFocusReserve));
+	}
+	return false;
+
+}
+
+void UShooterTraceScheduler::RollFrame()
+{
+
+	if (CurrentFrame == GFrameCounter) {
+		return;
+	}
+
+	CurrentFrame = GFrameCounter;
+	TracesThisFrame = 0;
+
+	if (CurrentFrame % CacheExpiryFrames == 0) {
+
+		for (auto It = Cache.CreateIterator(); It; ++It) {
+
+			if (!It.Key().Key.IsValid() || CurrentFrame - It.Value().TraceFrame > CacheExpiryFrames) {
+				It.RemoveCurrent();
+			}
+
+		}
+
+	}
+
+}
+
+bool UShooterTraceScheduler::LineTrace(EShooterTracePriority Priority,
+	const UObject* Requester,
+	FHitResult& OutHit,
+	const FVector& Start,
+	const FVector& End,
+	ECollisionChannel Channel,
+	const FCollisionQueryParams& Params)
+{
+
+	RollFrame();
+
+	FPriorityStats& PriorityStats = Stats[(int32)Priority];
+	FCachedTrace& Cached = Cache.FindOrAdd(TPair<TWeakObjectPtr<const UObject>, uint8>(Requester, (uint8)Priority));
+
+	if (!CanRun(Priority)) {
+
+		PriorityStats.Deferred++;
+		INC_DWORD_STAT(STAT_ShooterTracesDeferred);
+		CSV_CUSTOM_STAT(TheLastShooter, TracesDeferred, 1, ECsvCustomStatOp::Accumulate);
+
+		if (Cached.DeferredSinceFrame == 0) {
+			Cached.DeferredSinceFrame = CurrentFrame;
+			Cached.DeferredSinceSeconds = FPlatformTime::Seconds();
+		}
+
+		//both ends within the tolerance keep the whole ray within it
+		if (Cached.TraceFrame == 0
+			|| !FVector::PointsAreNear(Cached.Start, Start, GShooterTraceReuseTolerance)
+			|| !FVector::PointsAreNear(Cached.End, End, GShooterTraceReuseTolerance)) {
+			//never traced before or traced another ray, nothing to reuse
+			PriorityStats.DeferredWithoutResult++;
+			OutHit = FHitResult(Start, End);
+			return false;
+		}
+
+		OutHit = Cached.Hit;
+		return Cached.bBlockingHit;
+
+	}
+
+	if (Cached.DeferredSinceFrame != 0) {
+
+		const double WaitMs = (FPlatformTime::Seconds() - Cached.DeferredSinceSeconds) * 1000.0;
+		PriorityStats.Waits++;
+		PriorityStats.TotalWaitMs += WaitMs;
+		PriorityStats.MaxWaitMs = FMath::Max(PriorityStats.MaxWaitMs, WaitMs);
+		PriorityStats.MaxWaitFrames = FMath::Max(PriorityStats.MaxWaitFrames, CurrentFrame - Cached.DeferredSinceFrame);
+		Cached.DeferredSinceFrame = 0;
+
+	}
+
+	TracesThisFrame++;
+	PriorityStats.Executed++;
+	FShooterFrameCounters::Get().AddTraces();
+
+	const uint32 QueryStartCycles = FPlatformTime::Cycles();
+	const bool bBlockingHit = GetWorld()->LineTraceSingleByChannel(OutHit, Start, End, Channel, Params);
+	const uint32 QueryCycles = FPlatformTime::Cycles() - QueryStartCycles;
+	PriorityStats.TotalQueryCycles += QueryCycles;
+	PriorityStats.MaxQueryCycles = FMath::Max(PriorityStats.MaxQueryCycles, QueryCycles);
+
+	Cached.Hit = OutHit;
+	Cached.Start = Start;
+	Cached.End = End;
+	Cached.bBlockingHit = bBlockingHit;
+	Cached.TraceFrame = CurrentFrame;
+	return bBlockingHit;
+
+}
+
+void UShooterTraceScheduler::DumpToLog() const
+{
+
+	UE_LOG(LogShooter, Log, TEXT("Trace scheduler for %s, budget %d per frame, %s channels:"),
+		*GetWorld()->GetName(),
+		GShooterTraceBudgetPerFrame,
+		UseLegacyChannels() ? TEXT("legacy") : TEXT("dedicated"));
+	for (int32 Priority = 0; Priority < (int32)EShooterTracePriority::ESTP_Max; Priority++) {
+
+		const FPriorityStats& PriorityStats = Stats[Priority];
+		UE_LOG(LogShooter, Log, TEXT("  %-10s executed %lld, query avg %.2fus max %.2fus, deferred %lld (%lld without a result), wait avg %.2fms max %.2fms / %llu frames"),
+			GetPriorityName((EShooterTracePriority)Priority),
+			PriorityStats.Executed,
+			PriorityStats.Executed > 0 ? FPlatformTime::ToMilliseconds64(PriorityStats.TotalQueryCycles) * 1000.0 / PriorityStats.Executed : 0.0,
+			FPlatformTime::ToMilliseconds(PriorityStats.MaxQueryCycles) * 1000.0,
+			PriorityStats.Deferred,
+			PriorityStats.DeferredWithoutResult,
+			PriorityStats.Waits > 0 ? PriorityStats.TotalWaitMs / PriorityStats.Waits : 0.0,
+			PriorityStats.MaxWaitMs,
+			PriorityStats.MaxWaitFrames);
+
+	}
+
+}
+
+void UShooterTraceScheduler::ResetStats()
+{
+
+	for (FPriorityStats& PriorityStats : Stats) {
+		PriorityStats = FPriorityStats();
+	}
+
+}
+
+bool UShooterTraceScheduler::UseLegacyChannels()
+{
+	return GShooterTraceLegacyChannels != 0;
+}
+
+const TCHAR* UShooterTraceScheduler::GetPriorityName(EShooterTracePriority Priority)
+{
+
+	switch (Priority) {
+	case EShooterTracePriority::ESTP_Shot: return TEXT("Shot");
+	case EShooterTracePriority::ESTP_ItemFocus: return TEXT("ItemFocus");
+	}
+	return TEXT("Unknown");
+
+}
+
+static FAutoConsoleCommandWithWorldAndArgs CmdTraceScheduler(
+	TEXT("Shooter.TraceScheduler"),
+	TEXT("Logs executed and deferred gameplay traces per priority. 'Shooter.TraceScheduler reset' clears the counts."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World) {
+
+		UShooterTraceScheduler* Scheduler = World ? World->GetSubsystem<UShooterTraceScheduler>() : nullptr;
+		if (Scheduler == nullptr) {
+			return;
+		}
+
+		if (Args.Num() > 0 && Args[0] == TEXT("reset")) {
+			Scheduler->ResetStats();
+			return;
+		}
+		Scheduler->DumpToLog();
+
+	}));
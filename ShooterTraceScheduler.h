@@ -0,0 +1,84 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ShooterTraceScheduler.generated.h"
+
+enum class EShooterTracePriority : uint8 {
+	ESTP_Shot, // weapon and crosshair aim traces of a shot, never deferred
+	ESTP_ItemFocus, // pickup focus, first to go when the budget runs out
+
+	ESTP_Max
+};
+
+/**
+ * Every gameplay scene query goes through here. Keeps a per-frame trace budget
+ * (Shooter.Trace.BudgetPerFrame): shots always run, item focus only while the reserve kept for
+ * shots is untouched. A deferred query hands back the last result the same requester got for that
+ * priority when that ray ran within Shooter.Trace.ReuseTolerance of this one at both ends.
+ */
+UCLASS()
+class THELASTSHOOTER_API UShooterTraceScheduler : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	static UShooterTraceScheduler* Get(const UObject* WorldContextObject);
+
+	//same contract as UWorld::LineTraceSingleByChannel, returns true on a blocking hit
+	bool LineTrace(EShooterTracePriority Priority,
+		const UObject* Requester,
+		FHitResult& OutHit,
+		const FVector& Start,
+		const FVector& End,
+		ECollisionChannel Channel,
+		const FCollisionQueryParams& Params = FCollisionQueryParams::DefaultQueryParam);
+
+	void DumpToLog() const;
+	void ResetStats();
+
+	static const TCHAR* GetPriorityName(EShooterTracePriority Priority);
+
+	//Shooter.Trace.LegacyChannels, every trace back on 50,000 unit ECC_Visibility rays for comparisons
+	static bool UseLegacyChannels();
+
+private:
+	struct FCachedTrace
+	{
+		FHitResult Hit;
+		FVector Start = FVector::ZeroVector;
+		FVector End = FVector::ZeroVector;
+		bool bBlockingHit = false;
+		uint64 TraceFrame = 0;
+
+		//first frame this requester was turned away since its last real trace, 0 = not waiting
+		uint64 DeferredSinceFrame = 0;
+		double DeferredSinceSeconds = 0.0;
+	};
+
+	struct FPriorityStats
+	{
+		int64 Executed = 0;
+		int64 Deferred = 0;
+		int64 DeferredWithoutResult = 0;
+		int64 Waits = 0;
+		double TotalWaitMs = 0.0;
+		double MaxWaitMs = 0.0;
+		uint64 MaxWaitFrames = 0;
+
+		//scene query cost of executed traces
+		uint64 TotalQueryCycles = 0;
+		uint32 MaxQueryCycles = 0;
+	};
+
+	bool CanRun(EShooterTracePriority Priority) const;
+	void RollFrame();
+
+	TMap<TPair<TWeakObjectPtr<const UObject>, uint8>, FCachedTrace> Cache;
+	FPriorityStats Stats[(int32)EShooterTracePriority::ESTP_Max];
+
+	uint64 CurrentFrame = 0;
+	int32 TracesThisFrame = 0;
+};
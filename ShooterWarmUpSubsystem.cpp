@@ -0,0 +1,212 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterWarmUpSubsystem.h"
+#include "TheLastShooter.h"
+#include "ShooterPerf.h"
+#include "WeaponData.h"
+#include "Item.h"
+#include "Engine/AssetManager.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "Kismet/GameplayStatics.h"
+#include "Particles/ParticleSystem.h"
+#include "Particles/ParticleSystemComponent.h"
+#include "Sound/SoundCue.h"
+#include "Animation/AnimInstance.h"
+#include "Animation/AnimMontage.h"
+#include "Components/WidgetComponent.h"
+#include "Blueprint/UserWidget.h"
+
+UShooterWarmUpSubsystem::UShooterWarmUpSubsystem() :
+	WarmUpLocation(0.f, 0.f, -100'000.f),
+	WarmUpStartSeconds(0.0),
+	bWarmUpComplete(false)
+{
+}
+
+UShooterWarmUpSubsystem* UShooterWarmUpSubsystem::Get(const UObject* WorldContextObject)
+{
+
+	UWorld* World = GEngine ? GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::LogAndReturnNull) : nullptr;
+	return World ? World->GetSubsystem<UShooterWarmUpSubsystem>() : nullptr;
+
+}
+
+bool UShooterWarmUpSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+
+#if WITH_SHOOTER_COSMETICS
+	const UWorld* World = Cast<UWorld>(Outer);
+	return Super::ShouldCreateSubsystem(Outer) && !IsRunningDedicatedServer() && World && World->IsGameWorld();
+#else
+	return false;
+#endif
+
+}
+
+void UShooterWarmUpSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+
+	Super::Initialize(Collection);
+
+	WarmUpStartSeconds = FPlatformTime::Seconds();
+
+	if (UAssetManager::IsValid()) {
+
+		TArray<FPrimaryAssetId> WeaponDataIds;
+		UAssetManager::Get().GetPrimaryAssetIdList(UWeaponData::PrimaryAssetType, WeaponDataIds);
+		if (WeaponDataIds.Num() > 0) {
+
+			WeaponDataHandle = UAssetManager::Get().LoadPrimaryAssets(WeaponDataIds, UWeaponData::GetBundlesToLoad());
+
+		}
+
+	}
+
+	TArray<FSoftObjectPath> ItemClassPaths;
+	for (const TSoftClassPtr<AItem>& ItemClass : WarmUpItemClasses) {
+
+		if (!ItemClass.IsNull()) {
+			ItemClassPaths.Add(ItemClass.ToSoftObjectPath());
+		}
+
+	}
+
+	if (ItemClassPaths.Num() > 0) {
+
+		ItemClassesHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(ItemClassPaths);
+
+	}
+
+	TickStartHandle = FWorldDelegates::OnWorldTickStart.AddUObject(this, &UShooterWarmUpSubsystem::OnWorldTickStart);
+
+}
+
+void UShooterWarmUpSubsystem::Deinitialize()
+{
+
+	FWorldDelegates::OnWorldTickStart.Remove(TickStartHandle);
+	WeaponDataHandle.Reset();
+	ItemClassesHandle.Reset();
+	PrimedMontages.Reset();
+	Super::Deinitialize();
+
+}
+
+void UShooterWarmUpSubsystem::OnWorldTickStart(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+
+	if (World != GetWorld() || bWarmUpComplete) {
+		return;
+	}
+
+	for (const TSharedPtr<FStreamableHandle>& Handle : { WeaponDataHandle, ItemClassesHandle }) {
+
+		if (Handle.IsValid() && !Handle->HasLoadCompleted() && !Handle->WasCanceled()) {
+			return;
+		}
+
+	}
+	FinishWarmUp();
+
+}
+
+void UShooterWarmUpSubsystem::PrimeWeaponData(const UWeaponData* WeaponData)
+{
+
+	if (USoundCue* FireSound = WeaponData->FireSound.Get()) {
+		UGameplayStatics::PrimeSound(FireSound);
+	}
+
+	for (UParticleSystem* Template : { WeaponData->MuzzleFlash.Get(),
+		WeaponData->ImpactParticles.Get(),
+		WeaponData->BeamParticles.Get() }) {
+
+		if (Template == nullptr) {
+			continue;
+		}
+
+		UParticleSystemComponent* Emitter = UGameplayStatics::SpawnEmitterAtLocation(GetWorld(),
+			Template,
+			WarmUpLocation);
+		if (Emitter) {
+			Emitter->SetVectorParameter(WeaponData->BeamTargetParameter, WarmUpLocation);
+		}
+
+	}
+
+}
+
+void UShooterWarmUpSubsystem::PrimeItemClass(UClass* ItemClass)
+{
+
+	const AItem* ItemDefaults = ItemClass ? ItemClass->GetDefaultObject<AItem>() : nullptr;
+	UWidgetComponent* PickupWidget = ItemDefaults ? ItemDefaults->GetPickupWidget() : nullptr;
+	if (PickupWidget && PickupWidget->GetWidgetClass()) {
+		CreateWidget<UUserWidget>(GetWorld(), PickupWidget->GetWidgetClass());
+	}
+
+}
+
+void UShooterWarmUpSubsystem::PrimeMontage(UAnimInstance* AnimInstance, UAnimMontage* Montage)
+{
+
+	if (AnimInstance == nullptr || Montage == nullptr || PrimedMontages.Contains(Montage)) {
+		return;
+	}
+
+	//playing would cut a montage already running in the same slot group, try again on the next load
+	if (AnimInstance->IsAnyMontagePlaying()) {
+		return;
+	}
+
+	//the first Montage_Play sets up the instance, slot tracks and notifies; stopping with no blend
+	//before the next anim update leaves nothing on screen
+	const uint32 StartCycles = FPlatformTime::Cycles();
+	AnimInstance->Montage_Play(Montage);
+	AnimInstance->Montage_Stop(0.f, Montage);
+	PrimedMontages.Add(Montage);
+
+	UE_LOG(LogShooter, Log, TEXT("Warm-up primed montage %s in %.3f ms"),
+		*Montage->GetName(),
+		FPlatformTime::ToMilliseconds(FPlatformTime::Cycles() - StartCycles));
+
+}
+
+void UShooterWarmUpSubsystem::FinishWarmUp()
+{
+
+	if (bWarmUpComplete) {
+		return;
+	}
+	FShooterFrameCounters::Get().NoteEvent(TEXT("WarmUp"));
+
+	int32 NumWeaponData = 0;
+	if (WeaponDataHandle.IsValid()) {
+
+		TArray<UObject*> LoadedAssets;
+		WeaponDataHandle->GetLoadedAssets(LoadedAssets);
+		for (UObject* Asset : LoadedAssets) {
+
+			if (const UWeaponData* WeaponData = Cast<UWeaponData>(Asset)) {
+				PrimeWeaponData(WeaponData);
+				NumWeaponData++;
+			}
+
+		}
+
+	}
+
+	for (const TSoftClassPtr<AItem>& ItemClass : WarmUpItemClasses) {
+		PrimeItemClass(ItemClass.Get());
+	}
+
+	bWarmUpComplete = true;
+	FWorldDelegates::OnWorldTickStart.Remove(TickStartHandle);
+	UE_LOG(LogShooter, Log, TEXT("Cosmetic warm-up primed %d weapon data and %d item classes in %.2f ms"),
+		NumWeaponData,
+		WarmUpItemClasses.Num(),
+		(FPlatformTime::Seconds() - WarmUpStartSeconds) * 1000.0);
+
+}
@@ -0,0 +1,66 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Engine/StreamableManager.h"
+#include "ShooterWarmUpSubsystem.generated.h"
+
+/**
+ * Cosmetic warm-up on every instance that renders: clients, listen servers and standalone games.
+ * Loads every UWeaponData with its bundles, then spawns each emitter once out of sight, sets its
+ * beam parameter, primes the sounds and creates each pickup widget once. Fire montages are played
+ * and stopped once on the first character whose weapon data loads with them, see PrimeMontage.
+ * The game mode only loads what the server needs and holds players back until that is in.
+ *
+ * Item classes and the emitter location live in DefaultGame.ini:
+ * [/Script/TheLastShooter.ShooterWarmUpSubsystem]
+ * +WarmUpItemClasses=/Game/Items/BP_Weapon.BP_Weapon_C
+ */
+UCLASS(Config = Game)
+class THELASTSHOOTER_API UShooterWarmUpSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UShooterWarmUpSubsystem();
+
+	static UShooterWarmUpSubsystem* Get(const UObject* WorldContextObject);
+
+	//game worlds that are not a dedicated server
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	//plays and stops Montage on AnimInstance the first time it is seen, skipped while another montage plays
+	void PrimeMontage(class UAnimInstance* AnimInstance, class UAnimMontage* Montage);
+
+	FORCEINLINE bool IsWarmUpComplete() const { return bWarmUpComplete; }
+
+private:
+	//polls the loads, priming waits for a ticking world
+	void OnWorldTickStart(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+	void PrimeWeaponData(const class UWeaponData* WeaponData);
+	void PrimeItemClass(UClass* ItemClass);
+	void FinishWarmUp();
+
+	//items whose pickup widget gets created once during warm-up, weapons are found through their data
+	UPROPERTY(Config)
+	TArray<TSoftClassPtr<class AItem>> WarmUpItemClasses;
+
+	//emitters spawned for priming go here, out of sight
+	UPROPERTY(Config)
+	FVector WarmUpLocation;
+
+	TSharedPtr<FStreamableHandle> WeaponDataHandle;
+	TSharedPtr<FStreamableHandle> ItemClassesHandle;
+
+	TSet<TWeakObjectPtr<class UAnimMontage>> PrimedMontages;
+
+	FDelegateHandle TickStartHandle;
+
+	double WarmUpStartSeconds;
+	bool bWarmUpComplete;
+};
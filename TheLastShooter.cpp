@@ -2,5 +2,52 @@
 
 #include "TheLastShooter.h"
 #include "Modules/ModuleManager.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
 
 IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, TheLastShooter, "TheLastShooter" );
+
+DEFINE_LOG_CATEGORY(LogShooter);
+
+DEFINE_STAT(STAT_ShooterTraces);
+DEFINE_STAT(STAT_ShooterEmitters);
+DEFINE_STAT(STAT_ShooterItemStateTransitions);
+DEFINE_STAT(STAT_ShooterDamageQueued);
+DEFINE_STAT(STAT_ShooterDamageApplied);
+
+CSV_DEFINE_CATEGORY_MODULE(THELASTSHOOTER_API, TheLastShooter, true);
+
+void ShooterWorld::GetPlayerViewLocations(const UWorld* World, TArray<FVector>& OutLocations)
+{
+
+	OutLocations.Reset();
+	if (World == nullptr) {
+		return;
+	}
+
+	for (FConstPlayerControllerIterator It = World->GetPlayerControllerIterator(); It; ++It) {
+
+		const APlayerController* PlayerController = It->Get();
+		if (PlayerController == nullptr) {
+			continue;
+		}
+
+		FVector ViewLocation;
+		FRotator ViewRotation;
+		PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+		OutLocations.Add(ViewLocation);
+
+	}
+
+}
+
+float ShooterWorld::GetDistSquaredToNearest(const FVector& Location, const TArray<FVector>& ViewLocations)
+{
+
+	float Nearest = MAX_flt;
+	for (const FVector& ViewLocation : ViewLocations) {
+		Nearest = FMath::Min(Nearest, FVector::DistSquared(Location, ViewLocation));
+	}
+	return Nearest;
+
+}
@@ -3,4 +3,47 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
 
+DECLARE_LOG_CATEGORY_EXTERN(LogShooter, Log, All);
+
+DECLARE_STATS_GROUP(TEXT("TheLastShooter"), STATGROUP_TheLastShooter, STATCAT_Advanced);
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Traces"), STAT_ShooterTraces, STATGROUP_TheLastShooter, THELASTSHOOTER_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Emitters Spawned"), STAT_ShooterEmitters, STATGROUP_TheLastShooter, THELASTSHOOTER_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Item State Transitions"), STAT_ShooterItemStateTransitions, STATGROUP_TheLastShooter, THELASTSHOOTER_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Damage Events Queued"), STAT_ShooterDamageQueued, STATGROUP_TheLastShooter, THELASTSHOOTER_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Damage Events Applied"), STAT_ShooterDamageApplied, STATGROUP_TheLastShooter, THELASTSHOOTER_API);
+
+CSV_DECLARE_CATEGORY_MODULE_EXTERN(THELASTSHOOTER_API, TheLastShooter);
+
+// Named scope for hot gameplay code: stat cycle counter STAT_<Name> (declare it with DECLARE_CYCLE_STAT),
+// CSV profiler timing and an Insights CPU event, all under the same name.
+#define SHOOTER_SCOPE_CYCLE_COUNTER(Name) \
+	SCOPE_CYCLE_COUNTER(STAT_##Name); \
+	CSV_SCOPED_TIMING_STAT(TheLastShooter, Name); \
+	TRACE_CPUPROFILER_EVENT_SCOPE(Name)
+
+// Project trace channels. The names and the item focus profile live in DefaultEngine.ini:
+// [/Script/Engine.CollisionProfile]
+// +DefaultChannelResponses=(Channel=ECC_GameTraceChannel1,DefaultResponse=ECR_Block,bTraceType=True,bStaticObject=False,Name="Interactable")
+// +DefaultChannelResponses=(Channel=ECC_GameTraceChannel2,DefaultResponse=ECR_Block,bTraceType=True,bStaticObject=False,Name="WeaponFire")
+// +Profiles=(Name="Interactable",CollisionEnabled=QueryOnly,ObjectTypeName="WorldDynamic",CustomResponses=((Channel="Visibility",Response=ECR_Ignore),(Channel="Camera",Response=ECR_Ignore),(Channel="WorldStatic",Response=ECR_Ignore),(Channel="WorldDynamic",Response=ECR_Ignore),(Channel="Pawn",Response=ECR_Ignore),(Channel="PhysicsBody",Response=ECR_Ignore),(Channel="Vehicle",Response=ECR_Ignore),(Channel="Destructible",Response=ECR_Ignore),(Channel="Interactable",Response=ECR_Block),(Channel="WeaponFire",Response=ECR_Ignore)),HelpMessage="Item focus box, only answers the Interactable trace")
+// World geometry and item focus boxes block Interactable, so walls hide items from the focus trace.
+// The item profile ignores every other channel and everything but item boxes blocks WeaponFire.
+// AItem sets the same responses in code so items work without the profile.
+#define ECC_Interactable ECC_GameTraceChannel1
+#define ECC_WeaponFire ECC_GameTraceChannel2
+
+class UWorld;
+
+namespace ShooterWorld
+{
+	//view points of the human players, bots have no player controller and are left out
+	THELASTSHOOTER_API void GetPlayerViewLocations(const UWorld* World, TArray<FVector>& OutLocations);
+
+	//squared distance from Location to the nearest of ViewLocations, MAX_flt when there are none
+	THELASTSHOOTER_API float GetDistSquaredToNearest(const FVector& Location, const TArray<FVector>& ViewLocations);
+}
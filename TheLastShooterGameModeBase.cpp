@@ -2,4 +2,110 @@
 
 
 #include "TheLastShooterGameModeBase.h"
+#include "TheLastShooter.h"
+#include "ShooterPerf.h"
+#include "WeaponData.h"
+#include "Engine/AssetManager.h"
+#include "Animation/AnimMontage.h"
+#include "GameFramework/PlayerController.h"
 
+ATheLastShooterGameModeBase::ATheLastShooterGameModeBase() :
+	WarmUpStartSeconds(0.0),
+	bWarmUpComplete(false)
+{
+}
+
+void ATheLastShooterGameModeBase::InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage)
+{
+
+	Super::InitGame(MapName, Options, ErrorMessage);
+	BeginWarmUp();
+
+}
+
+bool ATheLastShooterGameModeBase::PlayerCanRestart_Implementation(APlayerController* Player)
+{
+	return bWarmUpComplete && Super::PlayerCanRestart_Implementation(Player);
+}
+
+void ATheLastShooterGameModeBase::BeginWarmUp()
+{
+
+	WarmUpStartSeconds = FPlatformTime::Seconds();
+
+	if (UAssetManager::IsValid()) {
+
+		TArray<FPrimaryAssetId> WeaponDataIds;
+		UAssetManager::Get().GetPrimaryAssetIdList(UWeaponData::PrimaryAssetType, WeaponDataIds);
+		if (WeaponDataIds.Num() > 0) {
+
+			WeaponDataHandle = UAssetManager::Get().LoadPrimaryAssets(WeaponDataIds,
+				UWeaponData::GetBundlesToLoad(),
+				FStreamableDelegate::CreateUObject(this, &ATheLastShooterGameModeBase::OnWarmUpAssetsLoaded));
+
+		}
+
+	}
+
+	//everything may have been resident already
+	OnWarmUpAssetsLoaded();
+
+}
+
+void ATheLastShooterGameModeBase::OnWarmUpAssetsLoaded()
+{
+
+	//streamable delegates also fire a tick later for requests that were complete on the spot,
+	//so ask the handle itself
+	if (WeaponDataHandle.IsValid() && !WeaponDataHandle->HasLoadCompleted() && !WeaponDataHandle->WasCanceled()) {
+		return;
+	}
+	FinishWarmUp();
+
+}
+
+void ATheLastShooterGameModeBase::FinishWarmUp()
+{
+
+	if (bWarmUpComplete) {
+		return;
+	}
+	FShooterFrameCounters::Get().NoteEvent(TEXT("WarmUp"));
+
+	int32 NumWeaponData = 0;
+	if (WeaponDataHandle.IsValid()) {
+
+		TArray<UObject*> LoadedAssets;
+		WeaponDataHandle->GetLoadedAssets(LoadedAssets);
+		for (UObject* Asset : LoadedAssets) {
+
+			//the montage is in the "Game" bundle and plays on the server too, the first play is primed per client
+			const UWeaponData* WeaponData = Cast<UWeaponData>(Asset);
+			if (WeaponData) {
+
+				UE_CLOG(!WeaponData->HipFireMontage.IsNull() && WeaponData->HipFireMontage.Get() == nullptr,
+					LogShooter, Warning, TEXT("Warm-up: %s montage did not load"), *WeaponData->GetName());
+				NumWeaponData++;
+
+			}
+
+		}
+
+	}
+
+	bWarmUpComplete = true;
+	UE_LOG(LogShooter, Log, TEXT("Warm-up loaded %d weapon data in %.2f ms"),
+		NumWeaponData,
+		(FPlatformTime::Seconds() - WarmUpStartSeconds) * 1000.0);
+
+	//players that joined while warming up were held back by PlayerCanRestart
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It) {
+
+		APlayerController* PlayerController = It->Get();
+		if (PlayerController && PlayerController->GetPawn() == nullptr && PlayerCanRestart(PlayerController)) {
+			RestartPlayer(PlayerController);
+		}
+
+	}
+
+}
@@ -4,14 +4,36 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/GameModeBase.h"
+#include "Engine/StreamableManager.h"
 #include "TheLastShooterGameModeBase.generated.h"
 
 /**
- * 
+ * Loads every UWeaponData with the bundles this instance needs while the map loads, so the first
+ * shot of the match does not wait on a load. Players are not started until this is done. Sounds,
+ * emitters, widgets and montages are primed on each client by UShooterWarmUpSubsystem.
  */
 UCLASS()
 class THELASTSHOOTER_API ATheLastShooterGameModeBase : public AGameModeBase
 {
 	GENERATED_BODY()
-	
+
+public:
+	ATheLastShooterGameModeBase();
+
+	virtual void InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage) override;
+
+	virtual bool PlayerCanRestart_Implementation(APlayerController* Player) override;
+
+	FORCEINLINE bool IsWarmUpComplete() const { return bWarmUpComplete; }
+
+protected:
+	void BeginWarmUp();
+	void OnWarmUpAssetsLoaded();
+	void FinishWarmUp();
+
+private:
+	TSharedPtr<FStreamableHandle> WeaponDataHandle;
+
+	double WarmUpStartSeconds;
+	bool bWarmUpComplete;
 };
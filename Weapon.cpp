@@ -2,8 +2,11 @@
 
 
 #include "Weapon.h"
+#include "ShooterCombatCore.h"
 
 AWeapon::AWeapon() :
+	Damage(20.f),
+	WeaponData(nullptr),
 	ThrowWeaponTime(0.7f),
 	bFalling(false)
 {
@@ -33,13 +36,9 @@ void AWeapon::ThrowWeapon()
 
 	const FVector MeshForward{ GetItemMesh()->GetForwardVector() };
 	const FVector MeshRight{ GetItemMesh()->GetRightVector() };
-	FVector ImpulseDirection = MeshRight.RotateAngleAxis(-20.f, MeshForward);
-
-	float RandomRotation{ 30.f }; 
-	ImpulseDirection = ImpulseDirection.RotateAngleAxis(RandomRotation, FVector(0.f, 0.f, 1.f));
-
-	ImpulseDirection *= 20'000.f;
-	GetItemMesh()->AddImpulse(ImpulseDirection);
+	const ShooterCombatCore::FVec3 Impulse = ShooterCombatCore::ThrowImpulse(ShooterCombatCore::FVec3{ MeshForward.X, MeshForward.Y, MeshForward.Z },
+		ShooterCombatCore::FVec3{ MeshRight.X, MeshRight.Y, MeshRight.Z });
+	GetItemMesh()->AddImpulse(FVector(Impulse.X, Impulse.Y, Impulse.Z));
 	
 	bFalling = true; 
 	GetWorldTimerManager().SetTimer(
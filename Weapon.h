@@ -24,10 +24,21 @@ protected:
 	void StopFalling();
 
 private:
+	//base damage per bullet, before body part and falloff multipliers
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Weapon Properties", meta = (AllowPrivateAccess = "true"))
+	float Damage;
+
+	//fire rate, spread, cosmetics and names, cosmetics load asynchronously on equip
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Weapon Properties", meta = (AllowPrivateAccess = "true"))
+	class UWeaponData* WeaponData;
+
 	FTimerHandle ThrowWeaponTimer;
 	float ThrowWeaponTime;
 	bool bFalling;
 
 public:
 	void ThrowWeapon();
+
+	FORCEINLINE float GetDamage() const { return Damage; }
+	FORCEINLINE UWeaponData* GetWeaponData() const { return WeaponData; }
 };
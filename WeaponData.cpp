@@ -0,0 +1,38 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WeaponData.h"
+
+const FPrimaryAssetType UWeaponData::PrimaryAssetType(TEXT("WeaponData"));
+
+UWeaponData::UWeaponData() :
+	AutomaticFireRate(0.1f),
+	ShootTimeDuration(0.05f),
+	ShootingSpread(0.3f),
+	RecoilPitchImpulse(80.f),
+	RecoilYawImpulse(25.f),
+	RecoilKickbackImpulse(120.f),
+	BarrelSocketName(TEXT("BarrelSocket")),
+	BeamTargetParameter(TEXT("Target")),
+	FireMontageSection(TEXT("MontageSectionStartFire"))
+{
+}
+
+FPrimaryAssetId UWeaponData::GetPrimaryAssetId() const
+{
+	return FPrimaryAssetId(PrimaryAssetType, GetFName());
+}
+
+TArray<FName> UWeaponData::GetBundlesToLoad()
+{
+
+	TArray<FName> Bundles;
+	Bundles.Add(FName(TEXT("Game")));
+#if WITH_SHOOTER_COSMETICS
+	if (!IsRunningDedicatedServer()) {
+		Bundles.Add(FName(TEXT("Client")));
+	}
+#endif
+	return Bundles;
+
+}
@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "WeaponData.generated.h"
+
+/**
+ * Everything a weapon needs to fire. Cosmetic assets sit in the "Client" bundle so a dedicated
+ * server never loads them, the montage in "Game" because the server animates the hitboxes too.
+ * The asset manager finds these through DefaultGame.ini:
+ *
+ * [/Script/Engine.AssetManagerSettings]
+ * +PrimaryAssetTypesToScan=(PrimaryAssetType="WeaponData",AssetBaseClass=/Script/TheLastShooter.WeaponData,bHasBlueprintClasses=False,bIsEditorOnly=False,Directories=((Path="/Game/Weapons")))
+ */
+UCLASS(BlueprintType)
+class THELASTSHOOTER_API UWeaponData : public UPrimaryDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	UWeaponData();
+
+	virtual FPrimaryAssetId GetPrimaryAssetId() const override;
+
+	static const FPrimaryAssetType PrimaryAssetType;
+
+	//bundles to load for this build, no "Client" on a dedicated server
+	static TArray<FName> GetBundlesToLoad();
+
+	//seconds between shots while the trigger is held
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Fire")
+	float AutomaticFireRate;
+
+	//how long a shot keeps the crosshair spread open
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Fire")
+	float ShootTimeDuration;
+
+	//crosshair spread added while a shot is open
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Fire")
+	float ShootingSpread;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Animation", meta = (AssetBundles = "Game"))
+	TSoftObjectPtr<class UAnimMontage> HipFireMontage;
+
+	//per shot kick of the procedural recoil springs, used instead of HipFireMontage where the anim instance has it on:
+	//pitch up and random yaw in degrees per second, kickback in cm per second
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Animation")
+	float RecoilPitchImpulse;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Animation")
+	float RecoilYawImpulse;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Animation")
+	float RecoilKickbackImpulse;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Cosmetics", meta = (AssetBundles = "Client"))
+	TSoftObjectPtr<class USoundCue> FireSound;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Cosmetics", meta = (AssetBundles = "Client"))
+	TSoftObjectPtr<class UParticleSystem> MuzzleFlash;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Cosmetics", meta = (AssetBundles = "Client"))
+	TSoftObjectPtr<UParticleSystem> ImpactParticles;
+
+	//smoke trail for bullets
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Cosmetics", meta = (AssetBundles = "Client"))
+	TSoftObjectPtr<UParticleSystem> BeamParticles;
+
+	//socket on the character mesh shots start from
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Names")
+	FName BarrelSocketName;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Names")
+	FName BeamTargetParameter;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Names")
+	FName FireMontageSection;
+};